@@ -0,0 +1,129 @@
+#include <cstdint>
+#include "Attacks.h"
+
+namespace Chess {
+    Magic rook_magics[64];
+    Magic bishop_magics[64];
+
+    // Shared storage for the sliding attack sets of every square
+    static Bitboard rook_table[0x19000];
+    static Bitboard bishop_table[0x1480];
+
+    // Walks each direction from the square until the edge or an occupied square.
+    // Used only to build the tables.
+    static Bitboard slow_attacks(const int directions[4][2], int square, Bitboard occupied) {
+        Bitboard attacks = 0;
+        for (int dir = 0; dir < 4; dir++) {
+            int col = square % 8 + directions[dir][0];
+            int row = square / 8 + directions[dir][1];
+            while (Geometry::inside(col, row)) {
+                attacks |= square_bb(row * 8 + col);
+                if (occupied & square_bb(row * 8 + col)) {
+                    break;
+                }
+                col += directions[dir][0];
+                row += directions[dir][1];
+            }
+        }
+        return attacks;
+    }
+
+    // Attacks on an empty board, without the last square of each ray, since
+    // pieces on the edge never block anything further
+    static Bitboard relevant_mask(const int directions[4][2], int square) {
+        Bitboard mask = 0;
+        for (int dir = 0; dir < 4; dir++) {
+            int col = square % 8 + directions[dir][0];
+            int row = square / 8 + directions[dir][1];
+            while (Geometry::inside(col + directions[dir][0], row + directions[dir][1])) {
+                mask |= square_bb(row * 8 + col);
+                col += directions[dir][0];
+                row += directions[dir][1];
+            }
+        }
+        return mask;
+    }
+
+#ifndef __BMI2__
+    // xorshift64*, seeded the same way every run so the tables are reproducible
+    static std::uint64_t next_random(std::uint64_t& state) {
+        state ^= state >> 12;
+        state ^= state << 25;
+        state ^= state >> 27;
+        return state * 2685821657736338717ULL;
+    }
+
+    // Seeds, one per row, that lead to a valid magic after only a few candidates,
+    // which keeps startup fast even in unoptimized builds
+    static const std::uint64_t MAGIC_SEEDS[8] = { 728, 10316, 55013, 32803, 12281, 15100, 16645, 255 };
+#endif // !__BMI2__
+
+    // Fills the magics for one piece type, searching for a multiplier per square
+    // that maps every relevant occupancy to a slot holding the right attack set
+    static void init_magics(const int directions[4][2], Magic magics[64], Bitboard* table) {
+        static Bitboard references[4096];
+#ifndef __BMI2__
+        static Bitboard occupancies[4096];
+        static int epoch[4096];
+        int attempt = 0;
+        for (int i = 0; i < 4096; i++) {
+            epoch[i] = 0;
+        }
+#endif // !__BMI2__
+        Bitboard* next = table;
+
+        for (int sq = 0; sq < 64; sq++) {
+            Magic& m = magics[sq];
+            m.mask = relevant_mask(directions, sq);
+            m.shift = 64 - pop_count(m.mask);
+            m.attacks = next;
+
+            // Enumerate every subset of the mask with the carry-rippler trick
+            int size = 0;
+            Bitboard subset = 0;
+            do {
+                references[size] = slow_attacks(directions, sq, subset);
+#ifdef __BMI2__
+                m.attacks[_pext_u64(subset, m.mask)] = references[size];
+#else
+                occupancies[size] = subset;
+#endif // __BMI2__
+                size++;
+                subset = (subset - m.mask) & m.mask;
+            } while (subset);
+            next += size;
+
+#ifndef __BMI2__
+            // Sparse random candidates until one has no conflicting collisions
+            std::uint64_t state = MAGIC_SEEDS[sq / 8];
+            bool found = false;
+            while (!found) {
+                do {
+                    m.magic = next_random(state) & next_random(state) & next_random(state);
+                } while (pop_count((m.magic * m.mask) >> 56) < 6);
+
+                attempt++;
+                found = true;
+                for (int i = 0; i < size; i++) {
+                    unsigned index = m.index(occupancies[i]);
+                    if (epoch[index] < attempt) {
+                        epoch[index] = attempt;
+                        m.attacks[index] = references[i];
+                    } else if (m.attacks[index] != references[i]) {
+                        found = false;
+                        break;
+                    }
+                }
+            }
+#endif // !__BMI2__
+        }
+    }
+
+    // Builds the sliding piece tables during static initialization
+    static struct AttackTablesInit {
+        AttackTablesInit() {
+            init_magics(Geometry::ROOK_DIRECTIONS, rook_magics, rook_table);
+            init_magics(Geometry::BISHOP_DIRECTIONS, bishop_magics, bishop_table);
+        }
+    } attack_tables_init;
+}
@@ -0,0 +1,55 @@
+#ifndef ATTACKS_H
+#define ATTACKS_H
+
+#include "Bitboard.h"
+#include "Geometry.h"
+#ifdef __BMI2__
+#include <immintrin.h>
+#endif // __BMI2__
+
+namespace Chess {
+    // Precomputed attack sets. Sliding pieces use magic bitboards: the occupied
+    // squares on a piece's lines are mapped to an index into a table of attack sets,
+    // either by a multiply and shift with a "magic" number, or with the PEXT
+    // instruction when the compiler targets BMI2 (e.g. make ARCH_FLAGS=-mbmi2).
+    // The tables are built once, before main() runs. Leaper attacks and the
+    // squares between two squares come from the compile-time tables in Geometry.h.
+
+    // The lookup data for one square and one sliding piece type
+    struct Magic {
+        // Squares whose occupancy can change the attack set (edges excluded)
+        Bitboard mask;
+        Bitboard magic;
+        Bitboard* attacks;
+        unsigned shift;
+
+        unsigned index(Bitboard occupied) const {
+#ifdef __BMI2__
+            return static_cast<unsigned>(_pext_u64(occupied, mask));
+#else
+            return static_cast<unsigned>(((occupied & mask) * magic) >> shift);
+#endif // __BMI2__
+        }
+    };
+
+    extern Magic rook_magics[64];
+    extern Magic bishop_magics[64];
+
+    // Squares a rook on the square attacks, given the occupied squares
+    inline Bitboard rook_attacks(int square, Bitboard occupied) {
+        const Magic& m = rook_magics[square];
+        return m.attacks[m.index(occupied)];
+    }
+
+    // Squares a bishop on the square attacks, given the occupied squares
+    inline Bitboard bishop_attacks(int square, Bitboard occupied) {
+        const Magic& m = bishop_magics[square];
+        return m.attacks[m.index(occupied)];
+    }
+
+    // Squares a queen on the square attacks, given the occupied squares
+    inline Bitboard queen_attacks(int square, Bitboard occupied) {
+        return rook_attacks(square, occupied) | bishop_attacks(square, occupied);
+    }
+}
+#endif // ATTACKS_H
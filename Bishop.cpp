@@ -1,14 +1,11 @@
 #include "Bishop.h"
-#include "Helper.h"
+#include "Geometry.h"
 
 namespace Chess {
     bool Bishop::legal_move_shape(const Position& start, const Position& end) const {
         // Check if it can diagonally move
-        // Check if the deltas are equal
-        if (ABS(start.first - end.first) == ABS(start.second - end.second)){
-            return true;
-        }
-
-        return false;
+        int from = square_of(start);
+        int to = square_of(end);
+        return from == to || (bishop_rays(from) & square_bb(to)) != 0;
     }
 }
@@ -0,0 +1,82 @@
+#ifndef BITBOARD_H
+#define BITBOARD_H
+
+#include <cstdint>
+#include "Piece.h"
+
+namespace Chess {
+    // A set of squares, one bit per square. Bit 0 is A1, bit 7 is H1 and bit 63 is H8,
+    // so squares are numbered row by row starting from white's side of the board.
+    typedef std::uint64_t Bitboard;
+
+    // Number of distinct piece designators (white and black KQRBNPM)
+    const int PIECE_TYPES = 14;
+
+    // Returns true if the position lies on the board
+    inline bool on_board(const Position& position) {
+        return position.first >= 'A' && position.first <= 'H' &&
+               position.second >= '1' && position.second <= '8';
+    }
+
+    // Converts a board position to a square number in [0, 64)
+    inline int square_of(const Position& position) {
+        return (position.second - '1') * 8 + (position.first - 'A');
+    }
+
+    // Converts a square number in [0, 64) back to a board position
+    inline Position position_of(int square) {
+        return Position('A' + square % 8, '1' + square / 8);
+    }
+
+    // Returns a bitboard with only the given square set
+    inline Bitboard square_bb(int square) { return Bitboard(1) << square; }
+
+    // Returns the number of squares in the set
+    inline int pop_count(Bitboard b) { return __builtin_popcountll(b); }
+
+    // Returns the lowest square in a non-empty set
+    inline int lsb(Bitboard b) { return __builtin_ctzll(b); }
+
+    // Removes the lowest square from a non-empty set and returns it
+    inline int pop_lsb(Bitboard& b) {
+        int square = lsb(b);
+        b &= b - 1;
+        return square;
+    }
+
+    // Piece types in the order used by piece_index()
+    enum PieceType { PAWN = 0, KNIGHT, BISHOP, ROOK, QUEEN, KING, MYSTERY };
+
+    // A piece stored in one byte: its piece_index(), or NO_PIECE for an empty square
+    typedef std::int8_t PieceCode;
+    const PieceCode NO_PIECE = -1;
+
+    // Returns the type of a piece code or index
+    inline PieceType piece_type(int index) { return static_cast<PieceType>(index % (PIECE_TYPES / 2)); }
+
+    // Returns the index of the piece of the given type and color
+    inline int piece_index(PieceType type, bool white) { return type + (white ? 0 : PIECE_TYPES / 2); }
+
+    // Maps a piece designator to an index in [0, PIECE_TYPES), white pieces first.
+    // Returns -1 if the designator is not a valid piece.
+    inline int piece_index(char piece_designator) {
+        switch (piece_designator) {
+            case 'P': return 0;
+            case 'N': return 1;
+            case 'B': return 2;
+            case 'R': return 3;
+            case 'Q': return 4;
+            case 'K': return 5;
+            case 'M': return 6;
+            case 'p': return 7;
+            case 'n': return 8;
+            case 'b': return 9;
+            case 'r': return 10;
+            case 'q': return 11;
+            case 'k': return 12;
+            case 'm': return 13;
+            default: return -1;
+        }
+    }
+}
+#endif // BITBOARD_H
@@ -1,6 +1,5 @@
 #include <iostream>
 #include <utility>
-#include <map>
 #ifndef _WIN32
 #include "Terminal.h"
 #endif // !_WIN32
@@ -9,89 +8,133 @@
 #include "Exceptions.h"
 
 namespace Chess {
-    Board::Board() {}
-
-    // Copy constructor
-    Board::Board(const Board &board) {
-        *this = board;
+    Board::Board() {
+        remove_all();
     }
 
-    // Assignment Operator
-    Board& Board::operator=(const Board & board) {
-        cleanup();
-        for (const_iterator cit = board.cbegin(); cit != board.cend(); ++cit){
-            Position pos = cit.current_pos();
-            const Piece* piece = board(pos);
-            if (piece != nullptr){
-                add_piece(pos, piece->to_ascii());
-            }
+    const Piece* Board::operator()(const Position &position) const {
+        if (!on_board(position)) {
+            return nullptr;
         }
-        return *this;
+        PieceCode code = squares[square_of(position)];
+        return code == NO_PIECE ? nullptr : piece_by_index(code);
     }
 
-    // Destructor
-    Board::~Board() {
-        cleanup();
-    }
 
-    const Piece* Board::operator()(const Position &position) const {
-        for (BoardType::const_iterator cit = occ.cbegin(); cit != occ.cend(); ++cit) {
-            if (cit->first == position) {
-                return cit->second;
-            }
+    Position Board::find_by_piece(const char &piece_designator) const {
+        int index = piece_index(piece_designator);
+        if (index >= 0 && piece_type(index) == KING) {
+            int sq = king_sq[index < PIECE_TYPES / 2 ? 0 : 1];
+            return sq < 0 ? Position(0, 0) : position_of(sq);
+        }
+        if (index < 0 || piece_bb[index] == 0) {
+            return std::make_pair(0, 0);
         }
-        return nullptr;
+        return position_of(lsb(piece_bb[index]));
     }
 
+    Bitboard Board::pieces(const char &piece_designator) const {
+        int index = piece_index(piece_designator);
+        return index < 0 ? 0 : piece_bb[index];
+    }
 
-    Position Board::find_by_piece(const char &piece_designator) const {
-        for (BoardType::const_iterator cit = occ.cbegin(); cit != occ.cend(); ++cit) {
-            if ((cit->second)->to_ascii() == piece_designator)
-                return cit->first;
+    void Board::update_totals(PieceCode code, int sq, int change) {
+        int color = code < PIECE_TYPES / 2 ? 0 : 1;
+        piece_count[code] += change;
+        material_total[color] += change * piece_by_index(code)->point_value();
+        phase_sum += change * phase_weight(code);
+        psq += piece_square(code, sq) * change;
+        if (piece_type(code) == KING) {
+            king_sq[color] = piece_bb[code] ? lsb(piece_bb[code]) : -1;
         }
-        return std::make_pair(0, 0);
     }
 
     // Adds new piece to game board
     void Board::add_piece(const Position &position, const char &piece_designator) {
-        // Creates piece object
-        Piece *piece = create_piece(piece_designator);
+        int index = piece_index(piece_designator);
 
         // Piece type is not valid
-        if (piece == nullptr) {
+        if (index < 0) {
             throw Exception("invalid designator");
         }
 
-        const Piece *existing_piece = (*this)(position);
+        // Invalid position
+        if (!on_board(position)) {
+            throw Exception("invalid position");
+        }
+
+        int sq = square_of(position);
 
         // Something exists at that position
-        if (existing_piece != nullptr) {
+        if (squares[sq] != NO_PIECE) {
             throw Exception("position is occupied");
         }
 
-        // Invalid position
-        if (position.first > 'H' || position.first < 'A' || position.second < '1' || position.second > '8') {
-            throw Exception("invalid position");
-        }
-
-        occ[position] = piece;
+        Bitboard bb = square_bb(sq);
+        squares[sq] = static_cast<PieceCode>(index);
+        piece_bb[index] |= bb;
+        color_occ[index < PIECE_TYPES / 2 ? 0 : 1] |= bb;
+        all_occ |= bb;
+        zobrist_key ^= zobrist_keys().pieces[index][sq];
+        update_totals(squares[sq], sq, 1);
     }
 
     // Removes piece from game board
     void Board::remove_piece(const Position &position) {
-        // Frees allocated memory
-        const Piece *piece = (*this)(position);
-        delete piece;
-        occ.erase(position);
+        if (!on_board(position)) {
+            return;
+        }
+
+        int sq = square_of(position);
+        PieceCode code = squares[sq];
+        if (code == NO_PIECE) {
+            return;
+        }
+
+        Bitboard bb = ~square_bb(sq);
+        piece_bb[code] &= bb;
+        color_occ[code < PIECE_TYPES / 2 ? 0 : 1] &= bb;
+        all_occ &= bb;
+        zobrist_key ^= zobrist_keys().pieces[code][sq];
+        squares[sq] = NO_PIECE;
+        update_totals(code, sq, -1);
+    }
+
+    // Relocates a piece by moving its code and bits
+    void Board::move_piece(const Position &start, const Position &end) {
+        int from = square_of(start);
+        int to = square_of(end);
+        PieceCode code = squares[from];
+
+        Bitboard bb = square_bb(from) | square_bb(to);
+        piece_bb[code] ^= bb;
+        color_occ[code < PIECE_TYPES / 2 ? 0 : 1] ^= bb;
+        all_occ ^= bb;
+        zobrist_key ^= zobrist_keys().pieces[code][from] ^ zobrist_keys().pieces[code][to];
+        squares[to] = code;
+        squares[from] = NO_PIECE;
+        psq += piece_square(code, to) - piece_square(code, from);
+        if (piece_type(code) == KING) {
+            king_sq[code < PIECE_TYPES / 2 ? 0 : 1] = lsb(piece_bb[code]);
+        }
     }
 
     // Removes all pieces of the board
     void Board::remove_all() {
-        for (BoardType::const_iterator it = occ.cbegin(); it != occ.cend(); ++it) {
-            const Piece* piece = (*this)(it->first);
-            delete piece;
+        for (int i = 0; i < PIECE_TYPES; i++) {
+            piece_bb[i] = 0;
+            piece_count[i] = 0;
+        }
+        color_occ[0] = color_occ[1] = 0;
+        material_total[0] = material_total[1] = 0;
+        king_sq[0] = king_sq[1] = -1;
+        psq = Score();
+        phase_sum = 0;
+        all_occ = 0;
+        zobrist_key = 0;
+        for (int sq = 0; sq < 64; sq++) {
+            squares[sq] = NO_PIECE;
         }
-        occ.clear();
     }
 
     // Displays chess board in console while user plays game
@@ -145,28 +188,7 @@ namespace Chess {
     }
 
     bool Board::has_valid_kings() const {
-        int white_king_count = 0;
-        int black_king_count = 0;
-        for (std::map<std::pair<char, char>, Piece *>::const_iterator it = occ.begin(); it != occ.end(); it++) {
-            if (it->second) {
-                switch (it->second->to_ascii()) {
-                case 'K':
-                    white_king_count++;
-                    break;
-                case 'k':
-                    black_king_count++;
-                    break;
-                }
-            }
-        }
-        return (white_king_count == 1) && (black_king_count == 1);
-    }
-
-    // Deallocate all the board pieces - for destructor & cleanup use
-    void Board::cleanup() {
-        for (BoardType::iterator it = occ.begin(); it != occ.end(); ++it) {
-            delete it->second;
-        }
+        return piece_count[piece_index(KING, true)] == 1 && piece_count[piece_index(KING, false)] == 1;
     }
 
     std::ostream &operator<<(std::ostream &os, const Board &board) {
@@ -2,8 +2,10 @@
 #define BOARD_H
 
 #include <iostream>
-#include <map>
 #include "Piece.h"
+#include "Bitboard.h"
+#include "Zobrist.h"
+#include "Evaluation.h"
 #include "Pawn.h"
 #include "Rook.h"
 #include "Knight.h"
@@ -23,17 +25,10 @@ namespace Chess {
 
     public:
         // Default constructor
+        // The board holds only bitboards and one-byte piece codes, so the
+        // compiler-generated copy constructor and assignment are plain copies.
         Board();
 
-        // Copy constructor
-        Board(const Board &b);
-
-        // Overload assignment operator 
-        Board& operator=(const Board &b);
-
-        // Destructor
-        ~Board();
-
         // Returns a const pointer to the piece at a prescribed location if it exists,
         // or nullptr if there is nothing there.
         const Piece* operator() (const Position& position) const;
@@ -51,6 +46,9 @@ namespace Chess {
         // Removes a piece object at the given position.
         void remove_piece(const Position& position);
 
+        // Moves the piece at start to the empty square end, keeping the same piece object
+        void move_piece(const Position& start, const Position& end);
+
         // Remove all pieces in a board
         void remove_all();
 
@@ -60,11 +58,40 @@ namespace Chess {
         // Returns true if the board has the right number of kings on it
         bool has_valid_kings() const;
 
-        // Cleanup function for removing any allocated memory
-        void cleanup();
+        // Returns the set of all occupied squares
+        Bitboard occupancy() const { return all_occ; }
+
+        // Returns the set of squares occupied by the designated player
+        Bitboard occupancy(bool white) const { return color_occ[white ? 0 : 1]; }
+
+        // Returns the set of squares holding the requested piece
+        Bitboard pieces(const char& piece_designator) const;
+
+        // Returns the set of squares holding pieces of the given type and color
+        Bitboard pieces(PieceType type, bool white) const { return piece_bb[piece_index(type, white)]; }
+
+        // Returns the total material point value of the designated player
+        int material(bool white) const { return material_total[white ? 0 : 1]; }
+
+        // Returns the number of pieces of the given type and color
+        int count(PieceType type, bool white) const { return piece_count[piece_index(type, white)]; }
+
+        // Returns the square of the designated player's king, or -1 if there is none.
+        // With more than one king on the board this is the lowest of their squares.
+        int king_square(bool white) const { return king_sq[white ? 0 : 1]; }
+
+        // Returns the sum of piece_square() over every piece, white's minus black's
+        Score piece_square_score() const { return psq; }
 
-        // Map to store the locations and types of each piece
-        typedef std::map<Position, Piece*> BoardType;
+        // Returns the game phase: the phase_weight() of every piece, at most PHASE_TOTAL
+        int phase() const { return phase_sum < PHASE_TOTAL ? phase_sum : PHASE_TOTAL; }
+
+        // Returns the Zobrist key of the piece placement, kept up to date as pieces are
+        // added, removed and moved. It does not include the player to move.
+        HashKey key() const { return zobrist_key; }
+
+        // Returns the code of the piece on a square, or NO_PIECE if it is empty
+        PieceCode code_at(int square) const { return squares[square]; }
 
         // Constant Iterator for the Board object
         // Keeps track of a cell location at all times, and moves up/right
@@ -120,8 +147,37 @@ namespace Chess {
 
 
     private:
-        // The sparse map storing the pieces, keyed off locations
-        std::map<Position, Piece*> occ;
+        // One bitboard per piece designator, indexed by piece_index()
+        Bitboard piece_bb[PIECE_TYPES];
+
+        // Squares occupied by white (index 0) and black (index 1) pieces
+        Bitboard color_occ[2];
+
+        // Squares occupied by any piece
+        Bitboard all_occ;
+
+        // XOR of the Zobrist keys of every piece on the board
+        HashKey zobrist_key;
+
+        // The code of the piece standing on each square, indexed by square_of()
+        PieceCode squares[64];
+
+        // Point value of each player's pieces, kept up to date like zobrist_key
+        int material_total[2];
+
+        // Number of pieces of each kind, indexed by piece_index()
+        int piece_count[PIECE_TYPES];
+
+        // Square of each player's king, or -1 if there is none
+        int king_sq[2];
+
+        // Material plus piece-square values and the uncapped phase, kept up to date the same way
+        Score psq;
+        int phase_sum;
+
+        // Updates the counts, material, piece-square score, phase and king square for a
+        // piece added (+1) to or removed (-1) from the square
+        void update_totals(PieceCode code, int sq, int change);
 
         // Write the board state to an output stream
         friend std::ostream& operator<< (std::ostream& os, const Board& board);
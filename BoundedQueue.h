@@ -0,0 +1,68 @@
+#ifndef BOUNDED_QUEUE_H
+#define BOUNDED_QUEUE_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <utility>
+
+namespace Chess {
+    // A first-in first-out queue shared between threads that holds at most a
+    // fixed number of items. Producers block while it is full, so a fast producer
+    // cannot run far ahead of slow consumers, and consumers block while it is empty.
+    template <typename T>
+    class BoundedQueue {
+
+    public:
+        explicit BoundedQueue(std::size_t capacity) : capacity(capacity > 0 ? capacity : 1), closed(false) {}
+
+        BoundedQueue(const BoundedQueue&) = delete;
+        BoundedQueue& operator=(const BoundedQueue&) = delete;
+
+        // Adds an item, waiting for room if the queue is full. Returns false,
+        // dropping the item, if the queue has been closed.
+        bool push(T item) {
+            std::unique_lock<std::mutex> lock(mutex);
+            not_full.wait(lock, [this] { return closed || items.size() < capacity; });
+            if (closed) {
+                return false;
+            }
+            items.push_back(std::move(item));
+            not_empty.notify_one();
+            return true;
+        }
+
+        // Removes the oldest item, waiting for one if the queue is empty. Returns
+        // false once the queue has been closed and every item has been taken.
+        bool pop(T& item) {
+            std::unique_lock<std::mutex> lock(mutex);
+            not_empty.wait(lock, [this] { return closed || !items.empty(); });
+            if (items.empty()) {
+                return false;
+            }
+            item = std::move(items.front());
+            items.pop_front();
+            not_full.notify_one();
+            return true;
+        }
+
+        // Marks the end of the input: no more items are accepted, and consumers
+        // stop once the remaining ones are taken
+        void close() {
+            std::lock_guard<std::mutex> lock(mutex);
+            closed = true;
+            not_full.notify_all();
+            not_empty.notify_all();
+        }
+
+    private:
+        const std::size_t capacity;
+        std::mutex mutex;
+        std::condition_variable not_full;
+        std::condition_variable not_empty;
+        std::deque<T> items;
+        bool closed;
+    };
+}
+#endif // BOUNDED_QUEUE_H
@@ -1,5 +1,6 @@
 #include <cstddef>
 #include "CreatePiece.h"
+#include "Bitboard.h"
 #include "Pawn.h"
 #include "Rook.h"
 #include "Knight.h"
@@ -10,25 +11,50 @@
 
 namespace Chess {
 
-	Piece* create_piece(const char& piece_designator) {
+	const Piece* create_piece(const char& piece_designator) {
+		static const King white_king(true);
+		static const King black_king(false);
+		static const Queen white_queen(true);
+		static const Queen black_queen(false);
+		static const Bishop white_bishop(true);
+		static const Bishop black_bishop(false);
+		static const Knight white_knight(true);
+		static const Knight black_knight(false);
+		static const Rook white_rook(true);
+		static const Rook black_rook(false);
+		static const Pawn white_pawn(true);
+		static const Pawn black_pawn(false);
+		static const Mystery white_mystery(true);
+		static const Mystery black_mystery(false);
+
 		switch (piece_designator) {
 
-			case 'K': return new King(true);
-			case 'k': return new King(false);
-			case 'Q': return new Queen(true);
-			case 'q': return new Queen(false);
-			case 'B': return new Bishop(true);
-			case 'b': return new Bishop(false);
-			case 'N': return new Knight(true);
-			case 'n': return new Knight(false);
-			case 'R': return new Rook(true);
-			case 'r': return new Rook(false);
-			case 'P': return new Pawn(true);
-			case 'p': return new Pawn(false);
-			case 'M': return new Mystery(true);
-			case 'm': return new Mystery(false);
+			case 'K': return &white_king;
+			case 'k': return &black_king;
+			case 'Q': return &white_queen;
+			case 'q': return &black_queen;
+			case 'B': return &white_bishop;
+			case 'b': return &black_bishop;
+			case 'N': return &white_knight;
+			case 'n': return &black_knight;
+			case 'R': return &white_rook;
+			case 'r': return &black_rook;
+			case 'P': return &white_pawn;
+			case 'p': return &black_pawn;
+			case 'M': return &white_mystery;
+			case 'm': return &black_mystery;
 			default: return nullptr;
 
 		}
 	}
+
+	const Piece* piece_by_index(int index) {
+		static const Piece* const pieces[PIECE_TYPES] = {
+			create_piece('P'), create_piece('N'), create_piece('B'), create_piece('R'),
+			create_piece('Q'), create_piece('K'), create_piece('M'),
+			create_piece('p'), create_piece('n'), create_piece('b'), create_piece('r'),
+			create_piece('q'), create_piece('k'), create_piece('m')
+		};
+		return pieces[index];
+	}
 }
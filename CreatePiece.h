@@ -4,7 +4,10 @@
 #include "Piece.h"
 
 namespace Chess {
-	// This function returns a pointer to a piece of the specified type
+	// This function returns a pointer to the shared piece of the specified type.
+	// Pieces are immutable, so there is exactly one instance per designator and
+	// the pointer stays valid for the life of the program; it must not be deleted.
+	// Returns nullptr if the designator is invalid.
 	// The piece designator should be one of:
 	//	'K': white king
 	//	'k': black king
@@ -20,6 +23,9 @@ namespace Chess {
 	//	'p': black pawn
 	//	'M': white mystery piece
 	//	'm': black mystery piece
-	Piece* create_piece(const char& piece_designator);
+	const Piece* create_piece(const char& piece_designator);
+
+	// Returns the shared piece for an index produced by piece_index() in Bitboard.h
+	const Piece* piece_by_index(int index);
 }
 #endif // CREATE_PIECE_H
@@ -0,0 +1,125 @@
+#include "Evaluation.h"
+#include "Attacks.h"
+#include "Board.h"
+
+namespace Chess {
+    namespace Evaluation {
+        // Bonus per square a piece can move to, after subtracting a typical count
+        // so that an average piece scores about zero; indexed by PieceType
+        constexpr Score MOBILITY[7] = { Score(), Score(4, 4), Score(5, 5), Score(2, 4), Score(1, 2), Score(), Score() };
+        constexpr int MOBILITY_BASE[7] = { 0, 4, 6, 7, 13, 0, 0 };
+
+        constexpr Score DOUBLED_PAWN(-10, -20);
+        constexpr Score ISOLATED_PAWN(-10, -15);
+
+        // Bonus for a passed pawn by the number of rows it has advanced
+        constexpr Score PASSED_PAWN[8] = {
+            Score(0, 0), Score(5, 10), Score(10, 15), Score(15, 25), Score(25, 40), Score(40, 65), Score(60, 100), Score(0, 0)
+        };
+
+        constexpr Bitboard FILE_A = 0x0101010101010101ULL;
+        constexpr Bitboard FILE_H = FILE_A << 7;
+
+        // For each player and square: the squares in front of a pawn there on its own
+        // and the neighbouring columns, which must hold no enemy pawn for it to be passed
+        struct PawnMasks {
+            Bitboard passed[2][64];
+            Bitboard neighbours[8];
+        };
+
+        constexpr PawnMasks make_pawn_masks() {
+            PawnMasks masks{};
+            for (int col = 0; col < 8; col++) {
+                if (col > 0) {
+                    masks.neighbours[col] |= FILE_A << (col - 1);
+                }
+                if (col < 7) {
+                    masks.neighbours[col] |= FILE_A << (col + 1);
+                }
+            }
+            for (int sq = 0; sq < 64; sq++) {
+                Bitboard span = (FILE_A << (sq % 8)) | masks.neighbours[sq % 8];
+                for (int r = 0; r < 8; r++) {
+                    Bitboard row_bb = Bitboard(0xFF) << (r * 8);
+                    if (r > sq / 8) {
+                        masks.passed[0][sq] |= span & row_bb;
+                    }
+                    if (r < sq / 8) {
+                        masks.passed[1][sq] |= span & row_bb;
+                    }
+                }
+            }
+            return masks;
+        }
+
+        inline constexpr PawnMasks PAWN_MASKS = make_pawn_masks();
+
+        // Squares attacked by a set of pawns
+        inline Bitboard pawn_attack_span(Bitboard pawns, bool white) {
+            if (white) {
+                return ((pawns & ~FILE_A) << 7) | ((pawns & ~FILE_H) << 9);
+            }
+            return ((pawns & ~FILE_A) >> 9) | ((pawns & ~FILE_H) >> 7);
+        }
+
+        // Mobility of one player's knights, bishops, rooks and queens
+        static Score mobility(const Board& board, bool white) {
+            const Bitboard occupied = board.occupancy();
+            const Bitboard area = ~board.occupancy(white) & ~pawn_attack_span(board.pieces(PAWN, !white), !white);
+            Score score;
+
+            for (int type = KNIGHT; type <= QUEEN; type++) {
+                Bitboard pieces = board.pieces(static_cast<PieceType>(type), white);
+                while (pieces) {
+                    int sq = pop_lsb(pieces);
+                    Bitboard targets;
+                    switch (type) {
+                        case KNIGHT: targets = knight_attacks(sq); break;
+                        case BISHOP: targets = bishop_attacks(sq, occupied); break;
+                        case ROOK: targets = rook_attacks(sq, occupied); break;
+                        default: targets = queen_attacks(sq, occupied); break;
+                    }
+                    score += MOBILITY[type] * (pop_count(targets & area) - MOBILITY_BASE[type]);
+                }
+            }
+            return score;
+        }
+
+        // Doubled, isolated and passed pawns of one player
+        static Score pawn_structure(const Board& board, bool white) {
+            const Bitboard own = board.pieces(PAWN, white);
+            const Bitboard enemy = board.pieces(PAWN, !white);
+            Score score;
+
+            for (int col = 0; col < 8; col++) {
+                int on_file = pop_count(own & (FILE_A << col));
+                if (on_file > 1) {
+                    score += DOUBLED_PAWN * (on_file - 1);
+                }
+                if (on_file > 0 && (own & PAWN_MASKS.neighbours[col]) == 0) {
+                    score += ISOLATED_PAWN * on_file;
+                }
+            }
+
+            Bitboard pawns = own;
+            while (pawns) {
+                int sq = pop_lsb(pawns);
+                if ((enemy & PAWN_MASKS.passed[white ? 0 : 1][sq]) == 0) {
+                    score += PASSED_PAWN[white ? sq / 8 : 7 - sq / 8];
+                }
+            }
+            return score;
+        }
+    }
+
+    int evaluate(const Board& board, bool white) {
+        Score score = board.piece_square_score()
+                      + Evaluation::mobility(board, true) - Evaluation::mobility(board, false)
+                      + Evaluation::pawn_structure(board, true) - Evaluation::pawn_structure(board, false);
+
+        // Blend by phase: all middlegame with full material, all endgame with none
+        int phase = board.phase();
+        int blended = (score.mg * phase + score.eg * (PHASE_TOTAL - phase)) / PHASE_TOTAL;
+        return white ? blended : -blended;
+    }
+}
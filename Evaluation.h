@@ -0,0 +1,177 @@
+#ifndef EVALUATION_H
+#define EVALUATION_H
+
+#include "Bitboard.h"
+
+namespace Chess {
+    class Board;
+
+    // Positional evaluation, in centipawns. Every term has a middlegame and an
+    // endgame value, and the two are blended by the game phase: the non-pawn
+    // material left on the board, from PHASE_TOTAL at the start down to 0.
+    //
+    // Material plus piece-square values only change when a piece is added,
+    // removed or moved, so Board keeps their sum up to date along with the phase.
+    // Mobility and pawn structure depend on the whole position and are computed
+    // from the bitboards when a position is evaluated.
+
+    // A middlegame and an endgame value
+    struct Score {
+        int mg;
+        int eg;
+
+        constexpr Score() : mg(0), eg(0) {}
+        constexpr Score(int middlegame, int endgame) : mg(middlegame), eg(endgame) {}
+
+        constexpr Score operator+(const Score& o) const { return Score(mg + o.mg, eg + o.eg); }
+        constexpr Score operator-(const Score& o) const { return Score(mg - o.mg, eg - o.eg); }
+        constexpr Score operator*(int n) const { return Score(mg * n, eg * n); }
+        Score& operator+=(const Score& o) { mg += o.mg; eg += o.eg; return *this; }
+        Score& operator-=(const Score& o) { mg -= o.mg; eg -= o.eg; return *this; }
+    };
+
+    // Phase of a full set of pieces; promotions can push the sum above it
+    const int PHASE_TOTAL = 24;
+
+    namespace Evaluation {
+        // Tables are written as seen from white, row 8 first, so they read like a
+        // board diagram; square_of() numbering starts at A1, hence the flip below
+        typedef int SquareTable[64];
+
+        constexpr Score MATERIAL[7] = {
+            Score(82, 94), Score(337, 281), Score(365, 297), Score(477, 512), Score(1025, 936), Score(0, 0), Score(0, 0)
+        };
+
+        // Phase contributed by one piece of each type, in PieceType order
+        constexpr int PHASE_WEIGHT[7] = { 0, 1, 1, 2, 4, 0, 0 };
+
+        constexpr SquareTable PAWN_SQUARES_MG = {
+              0,   0,   0,   0,   0,   0,   0,   0,
+             50,  50,  50,  50,  50,  50,  50,  50,
+             10,  10,  20,  30,  30,  20,  10,  10,
+              5,   5,  10,  25,  25,  10,   5,   5,
+              0,   0,   0,  20,  20,   0,   0,   0,
+              5,  -5, -10,   0,   0, -10,  -5,   5,
+              5,  10,  10, -20, -20,  10,  10,   5,
+              0,   0,   0,   0,   0,   0,   0,   0
+        };
+
+        constexpr SquareTable PAWN_SQUARES_EG = {
+              0,   0,   0,   0,   0,   0,   0,   0,
+             80,  80,  80,  80,  80,  80,  80,  80,
+             50,  50,  50,  50,  50,  50,  50,  50,
+             30,  30,  30,  30,  30,  30,  30,  30,
+             20,  20,  20,  20,  20,  20,  20,  20,
+             10,  10,  10,  10,  10,  10,  10,  10,
+              5,   5,   5,   5,   5,   5,   5,   5,
+              0,   0,   0,   0,   0,   0,   0,   0
+        };
+
+        constexpr SquareTable KNIGHT_SQUARES = {
+            -50, -40, -30, -30, -30, -30, -40, -50,
+            -40, -20,   0,   0,   0,   0, -20, -40,
+            -30,   0,  10,  15,  15,  10,   0, -30,
+            -30,   5,  15,  20,  20,  15,   5, -30,
+            -30,   0,  15,  20,  20,  15,   0, -30,
+            -30,   5,  10,  15,  15,  10,   5, -30,
+            -40, -20,   0,   5,   5,   0, -20, -40,
+            -50, -40, -30, -30, -30, -30, -40, -50
+        };
+
+        constexpr SquareTable BISHOP_SQUARES = {
+            -20, -10, -10, -10, -10, -10, -10, -20,
+            -10,   0,   0,   0,   0,   0,   0, -10,
+            -10,   0,   5,  10,  10,   5,   0, -10,
+            -10,   5,   5,  10,  10,   5,   5, -10,
+            -10,   0,  10,  10,  10,  10,   0, -10,
+            -10,  10,  10,  10,  10,  10,  10, -10,
+            -10,   5,   0,   0,   0,   0,   5, -10,
+            -20, -10, -10, -10, -10, -10, -10, -20
+        };
+
+        constexpr SquareTable ROOK_SQUARES = {
+              0,   0,   0,   0,   0,   0,   0,   0,
+              5,  10,  10,  10,  10,  10,  10,   5,
+             -5,   0,   0,   0,   0,   0,   0,  -5,
+             -5,   0,   0,   0,   0,   0,   0,  -5,
+             -5,   0,   0,   0,   0,   0,   0,  -5,
+             -5,   0,   0,   0,   0,   0,   0,  -5,
+             -5,   0,   0,   0,   0,   0,   0,  -5,
+              0,   0,   0,   5,   5,   0,   0,   0
+        };
+
+        constexpr SquareTable QUEEN_SQUARES = {
+            -20, -10, -10,  -5,  -5, -10, -10, -20,
+            -10,   0,   0,   0,   0,   0,   0, -10,
+            -10,   0,   5,   5,   5,   5,   0, -10,
+             -5,   0,   5,   5,   5,   5,   0,  -5,
+              0,   0,   5,   5,   5,   5,   0,  -5,
+            -10,   5,   5,   5,   5,   5,   0, -10,
+            -10,   0,   5,   0,   0,   0,   0, -10,
+            -20, -10, -10,  -5,  -5, -10, -10, -20
+        };
+
+        constexpr SquareTable KING_SQUARES_MG = {
+            -30, -40, -40, -50, -50, -40, -40, -30,
+            -30, -40, -40, -50, -50, -40, -40, -30,
+            -30, -40, -40, -50, -50, -40, -40, -30,
+            -30, -40, -40, -50, -50, -40, -40, -30,
+            -20, -30, -30, -40, -40, -30, -30, -20,
+            -10, -20, -20, -20, -20, -20, -20, -10,
+             20,  20,   0,   0,   0,   0,  20,  20,
+             20,  30,  10,   0,   0,  10,  30,  20
+        };
+
+        constexpr SquareTable KING_SQUARES_EG = {
+            -50, -40, -30, -20, -20, -30, -40, -50,
+            -30, -20, -10,   0,   0, -10, -20, -30,
+            -30, -10,  20,  30,  30,  20, -10, -30,
+            -30, -10,  30,  40,  40,  30, -10, -30,
+            -30, -10,  30,  40,  40,  30, -10, -30,
+            -30, -10,  20,  30,  30,  20, -10, -30,
+            -30, -30,   0,   0,   0,   0, -30, -30,
+            -50, -30, -30, -30, -30, -30, -30, -50
+        };
+
+        // Material plus piece-square value of every piece code on every square,
+        // from white's point of view, so black's entries are negative
+        struct PieceSquareScores {
+            Score scores[PIECE_TYPES][64];
+        };
+
+        constexpr PieceSquareScores make_piece_square_scores() {
+            const int* const middlegame[7] = { PAWN_SQUARES_MG, KNIGHT_SQUARES, BISHOP_SQUARES, ROOK_SQUARES, QUEEN_SQUARES, KING_SQUARES_MG, nullptr };
+            const int* const endgame[7] = { PAWN_SQUARES_EG, KNIGHT_SQUARES, BISHOP_SQUARES, ROOK_SQUARES, QUEEN_SQUARES, KING_SQUARES_EG, nullptr };
+
+            PieceSquareScores table{};
+            for (int type = 0; type < 7; type++) {
+                if (middlegame[type] == nullptr) {
+                    continue;
+                }
+                for (int sq = 0; sq < 64; sq++) {
+                    // A white piece on sq reads row 8 - row(sq) of the diagram; black's is the mirror
+                    int white_entry = (7 - sq / 8) * 8 + sq % 8;
+                    int black_entry = (sq / 8) * 8 + sq % 8;
+                    table.scores[type][sq] = MATERIAL[type]
+                        + Score(middlegame[type][white_entry], endgame[type][white_entry]);
+                    table.scores[type + PIECE_TYPES / 2][sq] = Score(0, 0) - MATERIAL[type]
+                        - Score(middlegame[type][black_entry], endgame[type][black_entry]);
+                }
+            }
+            return table;
+        }
+
+        inline constexpr PieceSquareScores PIECE_SQUARE = make_piece_square_scores();
+    }
+
+    // Material plus piece-square value of a piece on a square, positive for white
+    constexpr Score piece_square(int index, int square) { return Evaluation::PIECE_SQUARE.scores[index][square]; }
+
+    // Phase contributed by a piece
+    constexpr int phase_weight(int index) { return Evaluation::PHASE_WEIGHT[index % (PIECE_TYPES / 2)]; }
+
+    // Returns the evaluation of the position on the board from the point of view
+    // of the given player
+    int evaluate(const Board& board, bool white);
+}
+#endif // EVALUATION_H
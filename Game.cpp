@@ -1,10 +1,12 @@
+#include <algorithm>
 #include <cassert>
 #include <cstring>
 #include "Game.h"
-#include "Helper.h"
+#include "Attacks.h"
+#include "CreatePiece.h"
 
 namespace Chess {
-    Game::Game() : is_white_turn(true) {
+    Game::Game() : is_white_turn(true), halfmoves(0), fullmoves(1), status_valid(false) {
         // Add the pawns
         for (int i = 0; i < 8; i++) {
             board.add_piece(Position('A' + i, '1' + 1), 'P');
@@ -36,19 +38,6 @@ namespace Chess {
         board.add_piece(Position( 'A'+4 , '1'+7 ) , 'k' );
     }
 
-    // Copy constructor
-    Game::Game(const Game &game) {
-        *this = game;
-    }
-
-    // Assignment operator
-    Game& Game::operator=(const Game &game) {
-        cleanup();
-        this->board = Board(game.board);
-        this->is_white_turn = game.is_white_turn;
-        return *this;
-    }
-
     // Promotion function
     bool Game::check_promotion(const Position& start, const Position& end) const {
         const Piece* start_piece = board(start);
@@ -71,26 +60,66 @@ namespace Chess {
 
     }
 
+    const char* move_error_message(MoveError error) {
+        switch (error) {
+            case MOVE_OK: return "";
+            case START_NOT_ON_BOARD: return "start position is not on board";
+            case END_NOT_ON_BOARD: return "end position is not on board";
+            case NO_PIECE_AT_START: return "no piece at start position";
+            case WRONG_TURN: return "piece color and turn do not match";
+            case CAPTURES_OWN_PIECE: return "cannot capture own piece";
+            case ILLEGAL_CAPTURE_SHAPE: return "illegal capture shape";
+            case ILLEGAL_MOVE_SHAPE: return "illegal move shape";
+            case PATH_NOT_CLEAR: return "path is not clear";
+            case CAUSES_CHECK: return "this move causes a check";
+        }
+        return "";
+    }
+
     // Function to move pieces on the chess board
     void Game::make_move(const Position& start, const Position& end) {
 
+        // A legal move is found in the cached list, which already knows about promotion
+        if (on_board(start) && on_board(end)) {
+            const int from = square_of(start);
+            const int to = square_of(end);
+            for (const Move& move : status().legal_moves) {
+                if (move.from() == from && move.to() == to) {
+                    do_move(move);
+                    return;
+                }
+            }
+        }
+
         // Throw exceptions if player tries to make an illegal move
-        if (start.first > 'H' || start.first < 'A' || start.second < '1' || start.second > '8') {
-            throw Exception("start position is not on board");
+        MoveError error = validate_move(start, end);
+        if (error != MOVE_OK) {
+            throw Exception(move_error_message(error));
+        }
+
+        // Moves the piece, removing any captured piece and promoting if necessary,
+        // then changes turns
+        do_move(Move(square_of(start), square_of(end), check_promotion(start, end)));
+	}
+
+    // Checks a move with the same rules, and in the same order, as make_move
+    MoveError Game::validate_move(const Position& start, const Position& end) const {
+        if (!on_board(start)) {
+            return START_NOT_ON_BOARD;
         }
 
-        if (end.first > 'H' || end.first < 'A' || end.second < '1' || end.second > '8') {
-            throw Exception("end position is not on board");
+        if (!on_board(end)) {
+            return END_NOT_ON_BOARD;
         }
 
         const Piece* start_piece = board(start);
 
         if (start_piece == nullptr) {
-            throw Exception("no piece at start position");
+            return NO_PIECE_AT_START;
         }
 
         if (start_piece->is_white() != turn_white()) {
-            throw Exception("piece color and turn do not match");
+            return WRONG_TURN;
         }
 
         const Piece* end_piece = board(end);
@@ -101,282 +130,550 @@ namespace Chess {
 
             // But that place is occupied by my piece
             if (end_piece->is_white() == turn_white()) {
-                throw Exception("cannot capture own piece");
+                return CAPTURES_OWN_PIECE;
             }
 
             // But the path is illegal for the selected piece
             if (!start_piece->legal_capture_shape(start, end)) {
-                throw Exception("illegal capture shape");
+                return ILLEGAL_CAPTURE_SHAPE;
             }
         }
 
         // Non Capture Move Case
         else {
             if (!start_piece->legal_move_shape(start, end)) {
-                throw Exception("illegal move shape");
+                return ILLEGAL_MOVE_SHAPE;
             }
         }
 
         // As per Piazza, only check if is_path_clear() if it's NOT diagonal, vertical & horizontal
         // Accommodates for bishop and mystery piece
         if (is_path_linear(start, end) && !is_path_clear(start, end)) {
-            throw Exception("path is not clear");
-        }
-
-        // If it is a capture move, removes the piece at the end
-        if(end_piece != nullptr) {
-            // Removes captured piece
-            board.remove_piece(end);
+            return PATH_NOT_CLEAR;
         }
 
         // Do not allow a move if it will result in check
         if (would_check(start, end)) {
-            throw Exception("this move causes a check");
+            return CAUSES_CHECK;
         }
 
-        char piece_designator;
+        return MOVE_OK;
+    }
+
+    void Game::do_move(const Move& move) {
+        const Position start = move.start();
+        const Position end = move.end();
 
-        //Promotes piece if necesarry
-        if (check_promotion(start, end)) {
-            piece_designator = turn_white() ? 'Q' : 'q';
+        UndoRecord record;
+        record.move = move;
+        record.moved = board(start)->to_ascii();
+        const Piece* end_piece = board(end);
+        record.captured = end_piece != nullptr ? end_piece->to_ascii() : 0;
+        record.halfmoves = halfmoves;
+
+        // If it is a capture move, removes the piece at the end
+        if (end_piece != nullptr) {
+            board.remove_piece(end);
+        }
+
+        if (move.is_promotion()) {
+            board.remove_piece(start);
+            board.add_piece(end, is_white_turn ? 'Q' : 'q');
         } else {
-            piece_designator = start_piece->to_ascii();
+            board.move_piece(start, end);
         }
 
-        // First, add the piece to the requested location
-        board.add_piece(end, piece_designator);
+        // The clock restarts on captures and pawn moves
+        if (end_piece != nullptr || record.moved == 'P' || record.moved == 'p') {
+            halfmoves = 0;
+        } else {
+            halfmoves++;
+        }
+        if (!is_white_turn) {
+            fullmoves++;
+        }
 
-        // Then, removes piece at original location
-        board.remove_piece(start);
+        history.push_back(record);
+        is_white_turn = !is_white_turn;
+        status_valid = false;
+    }
 
-        // Finally, changes turns
+    void Game::undo_move() {
+        const UndoRecord record = history.back();
+        history.pop_back();
         is_white_turn = !is_white_turn;
+        status_valid = false;
+        halfmoves = record.halfmoves;
+        if (!is_white_turn) {
+            fullmoves--;
+        }
 
-	}
+        const Position start = record.move.start();
+        const Position end = record.move.end();
 
-    // Checks if the piece's path is linear
-    // Helpful when dealing with bishop and mystery piece
-	bool Game::is_path_linear(const Position& start, const Position& end) const {
-        // Vertical & horizontal
-        if (start.first == end.first || start.second == end.second) {
-            return true;
+        if (record.move.is_promotion()) {
+            board.remove_piece(end);
+            board.add_piece(start, record.moved);
+        } else {
+            board.move_piece(end, start);
         }
 
-        // Checks to see if piece moved in a diagonal
-        if (ABS(start.first - end.first) == ABS(start.second - end.second)) {
-            return true;
+        if (record.captured) {
+            board.add_piece(end, record.captured);
         }
+    }
 
-        return false;
+    // Checks if the piece's path is linear
+    // Helpful when dealing with bishop and mystery piece
+	bool Game::is_path_linear(const Position& start, const Position& end) const {
+        // Vertical, horizontal or diagonal, or no move at all
+        int from = square_of(start);
+        int to = square_of(end);
+        return from == to || line(from, to) != 0;
     }
 
     // Checks if the entered path is free of obstacles
     bool Game::is_path_clear(const Position &start, const Position &end) const {
 	    // This function assumes that all moves are legal - only checks
-	    // if the path is clear to the requested location.
-
-	    char start_col = start.first;
-	    char start_row = start.second;
-
-        char end_col = end.first;
-        char end_row = end.second;
-
-        if (start_row == end_row || start_col == end_col) {
-            // If going in a straight line
-
-            if (start_col == end_col) {
-                // Going up and down (vertical)
-
-                while (start_row != end_row) {
-                    // Check if the current position has any pieces
-                    const Piece* piece = board(Position(start_col, start_row));
-
-                    // If it does, return false
-                    // Don't check on the first iteration of the loop, as the
-                    // piece that the user is trying to move occupies that space.
-                    if (start_row != start.second && piece != nullptr) {
-                        return false;
-                    }
-
-
-                    // If it doesn't, increase or decrease the current row
-                    // and keep checking until it is the same
-                    // NOTE: The final position isn't checked as the user might
-                    // capture the piece at that position.
-                    if (start_row < end_row) {
-                        start_row++;
-                    } else {
-                        start_row--;
-                    }
-                }
+	    // if the path is clear to the requested location. The end position
+	    // isn't checked, as the user might capture the piece at that position.
+        // Paths that are not linear have no squares in between.
+        return (between(square_of(start), square_of(end)) & board.occupancy()) == 0;
+    }
 
-            } else {
-                // Going left and right (horizontal)
-                // Same implementation as above, just horizontally
-                while (start_col != end_col) {
-                    const Piece* piece = board(Position(start_col, start_row));
-                    if (start_col != start.first && piece != nullptr) {
-                        return false;
-                    }
+    // Returns the set of the designated player's pieces on the board that attack the
+    // square. It works backwards from the square: a piece attacks it exactly when a
+    // piece of the same type standing on the square would attack the piece.
+    static Bitboard attackers_on(const Board& board, int square, bool by_white) {
+        const Bitboard occupied = board.occupancy();
+        const Bitboard queens = board.pieces(QUEEN, by_white);
+
+        return (pawn_attacks(!by_white, square) & board.pieces(PAWN, by_white))
+             | (knight_attacks(square) & board.pieces(KNIGHT, by_white))
+             | (king_attacks(square) & board.pieces(KING, by_white))
+             | (bishop_attacks(square, occupied) & (board.pieces(BISHOP, by_white) | queens))
+             | (rook_attacks(square, occupied) & (board.pieces(ROOK, by_white) | queens));
+    }
 
-                    if (start_col < end_col) {
-                        start_col++;
-                    } else {
-                        start_col--;
-                    }
-                }
-            }
-        } else {
-            // If going diagonally
-            while (start_col != end_col) {
-                const Piece* piece = board(Position(start_col, start_row));
+    // Plays the move on the board, sees whether it leaves the designated player's
+    // king attacked, and takes it back. Promotion is irrelevant here, since the
+    // moving player's own pieces cannot attack their king.
+    static bool exposes_king(Board& board, const Move& move, bool white) {
+        const Position start = move.start();
+        const Position end = move.end();
+        const Piece* end_piece = board(end);
+        const char captured = end_piece != nullptr ? end_piece->to_ascii() : 0;
 
-                // If it is the first move, skip
-                if (start_col != start.first && piece != nullptr) {
-                    return false;
-                }
+        if (captured) {
+            board.remove_piece(end);
+        }
+        board.move_piece(start, end);
 
-                if (start_col < end_col) {
-                    start_col++;
-                } else {
-                    start_col--;
-                }
+        const int king = board.king_square(white);
+        const bool check = king >= 0 && attackers_on(board, king, !white) != 0;
 
-                if (start_row < end_row) {
-                    start_row++;
-                } else {
-                    start_row--;
-                }
-            }
+        board.move_piece(end, start);
+        if (captured) {
+            board.add_piece(end, captured);
         }
-
-        return true;
+        return check;
     }
 
     // Function to see if move would result in a check if made
     bool Game::would_check(const Position &start, const Position &end) const {
-        
-        // Creates new Game to test out move
-        Game new_game = Game(*this);
-
         // Since this would run at the very end, performing all necessary checks,
         // it would be safe to assume moving would be legal.
-
-        // Replicating setup on new board
-        const Piece* start_piece = new_game.board(start);
-        new_game.board.add_piece(end, start_piece->to_ascii());
-        new_game.board.remove_piece(start);
-
-        // Returns whether move would create check scenario
-        return new_game.in_check(new_game.turn_white());
+        Board scratch(board);
+        return exposes_king(scratch, Move(square_of(start), square_of(end)), board(start)->is_white());
     }
 
     // Determines if a player is in check
     bool Game::in_check(const bool& white) const {
         // Find location of correct king
-        char piece_designator = white ? 'K' : 'k';
-        const Position king_pos = board.find_by_piece(piece_designator);
-
-        // Loops through each opposing piece to see if any have a check
-        for (Board::const_iterator it = board.cbegin(); it != board.cend(); ++it) { //loop through map keys
-            const Piece * piece = board(it.current_pos());
+        const int king = board.king_square(white);
+        if (king < 0) {
+            return false;
+        }
 
-            // Creates a new hypothetical game to check and see piece could capture king
-            Game new_game = Game(*this);
+        // Looks up which opposing pieces attack the king's square
+        return attackers_to(king, !white) != 0;
+    }
 
-            if (piece != nullptr && piece->is_white() != white) {
-                if (piece->legal_capture_shape(it.current_pos(), king_pos)) {
-                    if (new_game.is_path_clear(it.current_pos(), king_pos)) {
-                        return true;
-                    }
-                }
-            } 
-        }
-        return false;
+    Bitboard Game::attackers_to(int square, bool by_white) const {
+        return attackers_on(board, square, by_white);
     }
 
     // Checks if a given piece has any possible moves
-    // Loops through each position in board, and sees if our piece can move there
     bool Game::is_possible_move(const Position& pos) const {
-        for (Board::const_iterator cit = board.cbegin(); cit != board.cend(); ++cit) {
-            Game new_game = Game(*this);
-            try {
-                new_game.make_move(pos, cit.current_pos());
-            } catch(Exception& exception) {
-                continue;
+        const Piece* piece = board(pos);
+        if (piece == nullptr) {
+            return false;
+        }
+
+        MoveList moves;
+        add_legal_moves(piece->is_white(), moves);
+        for (const Move& move : moves) {
+            if (move.start() == pos) {
+                return true;
             }
-            return true;
         }
         return false;
     }
 
-    // If a) there is no check, or b) a move can be made to prevent a check, returns false
-    // To check b), loops through each piece to and calls prevent_check()
+    const GameStatus& Game::status() const {
+        if (!status_valid) {
+            cached_status.legal_moves.clear();
+            add_legal_moves(is_white_turn, cached_status.legal_moves);
+            cached_status.check = in_check(is_white_turn);
+            cached_status.mate = cached_status.check && cached_status.legal_moves.empty();
+            cached_status.stalemate = !cached_status.check && cached_status.legal_moves.empty();
+            cached_status.material = board.material(is_white_turn);
+            cached_status.opponent_material = board.material(!is_white_turn);
+            status_valid = true;
+        }
+        return cached_status;
+    }
+
+    // A player is in mate if they are in check and have no legal move left
     bool Game::in_mate(const bool& white) const {
+        if (white == is_white_turn) {
+            return status().mate;
+        }
         if (!in_check(white)) {
             return false;
         }
 
-        // Check if moving other pieces can escape a check
-        for (Board::const_iterator cit = board.cbegin(); cit != board.cend(); ++cit){
-            const Piece * piece = board(cit.current_pos());
-            if (piece != nullptr && piece->is_white() == white) {
-                if (prevent_check(cit.current_pos())) {
-                    return false;
-                }
-            }
-        }
-
-        return true;
+        MoveList moves;
+        add_legal_moves(white, moves);
+        return moves.empty();
     }
 
     // Determine if another piece could be moved for king to escape check
     bool Game::prevent_check(const Position& pos) const {
-        // Iterate through board
-        for (Board::const_iterator cit = board.cbegin(); cit != board.cend(); ++cit) {
-            Game new_game = Game(*this);
-            try {
-                new_game.make_move(pos, cit.current_pos());
-            } catch(Exception& exception) {
-                continue;
+        return is_possible_move(pos);
+    }
+
+    // Checks if every one of a color's pieces have no possible moves
+    bool Game::in_stalemate(const bool& white) const {
+        if (white == is_white_turn) {
+            return status().legal_moves.empty();
+        }
+        MoveList moves;
+        add_legal_moves(white, moves);
+        return moves.empty();
+    }
+
+    MoveList Game::generate_pseudo_legal_moves() const {
+        MoveList moves;
+        add_pseudo_legal_moves(is_white_turn, moves);
+        return moves;
+    }
+
+    MoveList Game::generate_legal_moves() const {
+        MoveList moves;
+        add_legal_moves(is_white_turn, moves);
+        return moves;
+    }
+
+    bool Game::find_uci_move(std::string_view text, Move& move) const {
+        const MoveList& moves = status().legal_moves;
+        for (int i = 0; i < moves.size(); i++) {
+            std::string name = moves[i].uci_name();
+            if (name == text || (moves[i].is_promotion() && text.size() == 4 && name.compare(0, 4, text) == 0)) {
+                move = moves[i];
+                return true;
             }
-            return true;
         }
         return false;
     }
 
-    // Checks if every one of a color's pieces have no possible moves
-    // Calls is_possible_move for each piece
-    bool Game::in_stalemate(const bool& white) const {
-        for (Board::const_iterator cit = board.cbegin(); cit != board.cend(); ++cit) {
-            const Piece * piece = board(cit.current_pos());
+    // Adds a move from the square to each square in the set
+    static void add_moves(int from, Bitboard targets, MoveList& moves) {
+        while (targets) {
+            moves.add(Move(from, pop_lsb(targets)));
+        }
+    }
+
+    // Generates moves with the same rules as make_move, using the attack tables to
+    // find the squares each piece can reach
+    void Game::add_pseudo_legal_moves(const bool& white, MoveList& moves) const {
+        const Bitboard own = board.occupancy(white);
+        const Bitboard enemy = board.occupancy(!white);
+        const Bitboard occupied = board.occupancy();
+
+        for (Bitboard pieces = own; pieces; ) {
+            const int from = pop_lsb(pieces);
+
+            switch (piece_type(board.code_at(from))) {
+            case PAWN: {
+                const int forward = white ? 8 : -8;
+                const int last_row = white ? 7 : 0;
+                const int first_row = white ? 1 : 6;
+
+                // One square forward onto an empty square, or two from the starting row
+                const int one = from + forward;
+                if (one >= 0 && one < 64 && !(occupied & square_bb(one))) {
+                    moves.add(Move(from, one, one / 8 == last_row));
+
+                    const int two = one + forward;
+                    if (from / 8 == first_row && !(occupied & square_bb(two))) {
+                        moves.add(Move(from, two, two / 8 == last_row));
+                    }
+                }
 
-            if (piece != nullptr && piece->is_white() == white) {
-                if (is_possible_move(cit.current_pos())) {
-                    return false;
+                // Diagonal captures
+                for (Bitboard captures = pawn_attacks(white, from) & enemy; captures; ) {
+                    const int to = pop_lsb(captures);
+                    moves.add(Move(from, to, to / 8 == last_row));
                 }
+                break;
+            }
+            case KNIGHT:
+                add_moves(from, knight_attacks(from) & ~own, moves);
+                break;
+            case BISHOP:
+                add_moves(from, bishop_attacks(from, occupied) & ~own, moves);
+                break;
+            case ROOK:
+                add_moves(from, rook_attacks(from, occupied) & ~own, moves);
+                break;
+            case QUEEN:
+                add_moves(from, queen_attacks(from, occupied) & ~own, moves);
+                break;
+            case KING:
+                add_moves(from, king_attacks(from) & ~own, moves);
+                break;
+            case MYSTERY:
+                // Mystery pieces have no legal move shape
+                break;
             }
         }
+    }
 
-        return true;
+    // Every candidate is tried on one scratch copy of the board, which is made once
+    // per call; the game itself, with its history and cached status, is not copied
+    void Game::add_legal_moves(const bool& white, MoveList& moves) const {
+        MoveList candidates;
+        add_pseudo_legal_moves(white, candidates);
+        if (candidates.empty()) {
+            return;
+        }
+
+        Board scratch(board);
+        for (const Move& move : candidates) {
+            if (!exposes_king(scratch, move, white)) {
+                moves.add(move);
+            }
+        }
     }
 
     // Return the total material point value of the designated player
     int Game::point_value(const bool& white) const {
-        int point_val = 0;
-        for (Board::const_iterator cit = board.cbegin(); cit != board.cend(); ++cit) {
-            const Piece * piece = board(cit.current_pos());
+        return board.material(white);
+    }
+
+    // Splits the next whitespace-separated field off the front of a FEN record
+    static std::string_view next_fen_field(std::string_view& rest) {
+        const char* const SPACES = " \t\r\n";
+        std::string_view::size_type begin = rest.find_first_not_of(SPACES);
+        if (begin == std::string_view::npos) {
+            rest = std::string_view();
+            return rest;
+        }
+        rest.remove_prefix(begin);
+        std::string_view::size_type end = std::min(rest.find_first_of(SPACES), rest.size());
+        std::string_view field = rest.substr(0, end);
+        rest.remove_prefix(end);
+        return field;
+    }
+
+    // Reads a move counter, which must be a small non-negative number
+    static bool parse_fen_counter(std::string_view field, int& value) {
+        if (field.empty() || field.size() > 6) {
+            return false;
+        }
+        value = 0;
+        for (char c : field) {
+            if (c < '0' || c > '9') {
+                return false;
+            }
+            value = value * 10 + (c - '0');
+        }
+        return true;
+    }
+
+    void Game::load_fen(std::string_view fen) {
+        std::string_view rest = fen;
+
+        // Piece placement, from row 8 down to row 1, each row from column A to H.
+        // It is built on a separate board so a bad record leaves the game as it was.
+        Board parsed;
+        std::string_view placement = next_fen_field(rest);
+        int row = 7;
+        int col = 0;
+        for (char c : placement) {
+            if (c == '/') {
+                if (col != 8 || row == 0) {
+                    throw Exception("invalid FEN piece placement");
+                }
+                row--;
+                col = 0;
+            } else if (c >= '1' && c <= '8') {
+                col += c - '0';
+                if (col > 8) {
+                    throw Exception("invalid FEN piece placement");
+                }
+            } else {
+                if (col >= 8) {
+                    throw Exception("invalid FEN piece placement");
+                }
+                // add_piece() throws if the designator is not a piece
+                parsed.add_piece(Position('A' + col, '1' + row), c);
+                col++;
+            }
+        }
+        if (row != 0 || col != 8) {
+            throw Exception("invalid FEN piece placement");
+        }
+
+        std::string_view side = next_fen_field(rest);
+        if (side != "w" && side != "b") {
+            throw Exception("invalid FEN side to move");
+        }
+
+        std::string_view castling = next_fen_field(rest);
+        if (!castling.empty() && castling != "-") {
+            for (char c : castling) {
+                if (c != 'K' && c != 'Q' && c != 'k' && c != 'q') {
+                    throw Exception("invalid FEN castling rights");
+                }
+            }
+        }
+
+        std::string_view en_passant = next_fen_field(rest);
+        if (!en_passant.empty() && en_passant != "-"
+            && (en_passant.size() != 2 || en_passant[0] < 'a' || en_passant[0] > 'h'
+                || (en_passant[1] != '3' && en_passant[1] != '6'))) {
+            throw Exception("invalid FEN en passant square");
+        }
+
+        int halfmove_field = 0;
+        int fullmove_field = 1;
+        std::string_view halfmove_text = next_fen_field(rest);
+        if (!halfmove_text.empty() && !parse_fen_counter(halfmove_text, halfmove_field)) {
+            throw Exception("invalid FEN halfmove clock");
+        }
+        std::string_view fullmove_text = next_fen_field(rest);
+        if (!fullmove_text.empty() && (!parse_fen_counter(fullmove_text, fullmove_field) || fullmove_field == 0)) {
+            throw Exception("invalid FEN fullmove number");
+        }
+        if (!next_fen_field(rest).empty()) {
+            throw Exception("unexpected text after FEN record");
+        }
+
+        board = parsed;
+        is_white_turn = side == "w";
+        halfmoves = halfmove_field;
+        fullmoves = fullmove_field;
+        history.clear();
+        status_valid = false;
+    }
+
+    std::string Game::to_fen() const {
+        std::string fen;
+        fen.reserve(96);
+        for (int row = 7; row >= 0; row--) {
+            int empty = 0;
+            for (int col = 0; col < 8; col++) {
+                PieceCode code = board.code_at(row * 8 + col);
+                if (code == NO_PIECE) {
+                    empty++;
+                    continue;
+                }
+                if (empty > 0) {
+                    fen += static_cast<char>('0' + empty);
+                    empty = 0;
+                }
+                fen += piece_by_index(code)->to_ascii();
+            }
+            if (empty > 0) {
+                fen += static_cast<char>('0' + empty);
+            }
+            if (row > 0) {
+                fen += '/';
+            }
+        }
+        fen += is_white_turn ? " w - - " : " b - - ";
+        fen += std::to_string(halfmoves);
+        fen += ' ';
+        fen += std::to_string(fullmoves);
+        return fen;
+    }
+
+    PackedPosition Game::to_packed() const {
+        PackedPosition packed = {};
+        Bitboard occupied = board.occupancy();
+        if (pop_count(occupied) > PackedPosition::MAX_PIECES) {
+            throw Exception("too many pieces to pack");
+        }
+
+        for (int i = 0; i < 8; i++) {
+            packed.bytes[i] = static_cast<std::uint8_t>(occupied >> (8 * i));
+        }
+        for (int n = 0; occupied; n++) {
+            int code = board.code_at(pop_lsb(occupied));
+            packed.bytes[8 + n / 2] |= static_cast<std::uint8_t>(code << (n % 2 == 0 ? 0 : 4));
+        }
+
+        int fullmove = std::min(fullmoves, 0xFFFF);
+        packed.bytes[24] = is_white_turn ? 0 : 1;
+        packed.bytes[25] = static_cast<std::uint8_t>(std::min(halfmoves, 0xFF));
+        packed.bytes[26] = static_cast<std::uint8_t>(fullmove & 0xFF);
+        packed.bytes[27] = static_cast<std::uint8_t>(fullmove >> 8);
+        return packed;
+    }
 
-            if (piece != nullptr && piece->is_white() == white) {
-                point_val += piece->point_value();
+    void Game::from_packed(const PackedPosition& packed) {
+        static const char DESIGNATORS[] = "PNBRQKMpnbrqkm";
+
+        Bitboard occupied = packed.occupancy();
+        int count = pop_count(occupied);
+        if (count > PackedPosition::MAX_PIECES) {
+            throw Exception("invalid packed position");
+        }
+
+        // Built on a separate board so a bad record leaves the game as it was
+        Board unpacked;
+        for (int n = 0; occupied; n++) {
+            int code = packed.piece(n);
+            if (code >= PIECE_TYPES) {
+                throw Exception("invalid packed position");
             }
+            unpacked.add_piece(position_of(pop_lsb(occupied)), DESIGNATORS[code]);
+        }
+        for (int n = count; n < PackedPosition::MAX_PIECES; n++) {
+            if (packed.piece(n) != 0) {
+                throw Exception("invalid packed position");
+            }
+        }
+        if ((packed.bytes[24] & ~1) != 0 || packed.fullmove_number() == 0
+            || (packed.bytes[28] | packed.bytes[29] | packed.bytes[30] | packed.bytes[31]) != 0) {
+            throw Exception("invalid packed position");
         }
-        return point_val;
+
+        board = unpacked;
+        is_white_turn = packed.white_to_move();
+        halfmoves = packed.halfmove_clock();
+        fullmoves = packed.fullmove_number();
+        history.clear();
+        status_valid = false;
     }
 
     // Overload >> operator to help load a game from a file
     std::istream& operator>> (std::istream& is, Game& game) {
         game.board.remove_all();
+        game.history.clear();
+        game.status_valid = false;
 
         // add_piece() will throw an exception if any piece other than the designated ones
         for (int row = '8'; row >= '1'; row--) {
@@ -396,14 +693,11 @@ namespace Chess {
 
         game.is_white_turn = turn_designator == 'w';
 
-        return is;
-    }
+        // The save format has no move counters
+        game.halfmoves = 0;
+        game.fullmoves = 1;
 
-    // Destructor
-    Game::~Game() {}
-
-    void Game::cleanup() {
-        board.cleanup();
+        return is;
     }
 
     std::ostream& operator<< (std::ostream& os, const Game& game) {
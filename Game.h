@@ -2,12 +2,50 @@
 #define GAME_H
 
 #include <iostream>
+#include <string>
+#include <string_view>
+#include <vector>
 #include "Piece.h"
 #include "Board.h"
+#include "Move.h"
+#include "PackedPosition.h"
 #include "Exceptions.h"
 
 namespace Chess {
 
+	// The reasons make_move can reject a move, returned by validate_move
+	enum MoveError {
+		MOVE_OK = 0,
+		START_NOT_ON_BOARD,
+		END_NOT_ON_BOARD,
+		NO_PIECE_AT_START,
+		WRONG_TURN,
+		CAPTURES_OWN_PIECE,
+		ILLEGAL_CAPTURE_SHAPE,
+		ILLEGAL_MOVE_SHAPE,
+		PATH_NOT_CLEAR,
+		CAUSES_CHECK
+	};
+
+	// Returns the message make_move throws for the given error
+	const char* move_error_message(MoveError error);
+
+	// What a player looking at the board wants to know about the position, all
+	// worked out from a single pass of the move generator
+	struct GameStatus {
+		// Every legal move for the player to move
+		MoveList legal_moves;
+
+		// Whether the player to move is in check, checkmated or stalemated
+		bool check;
+		bool mate;
+		bool stalemate;
+
+		// Material point values of the player to move and of the opponent
+		int material;
+		int opponent_material;
+	};
+
 	class Game {
 
 	public:
@@ -15,14 +53,29 @@ namespace Chess {
 		// piece positions, and sets the state to white's turn
 		Game();
 
-		// Copy constructor
-		Game(const Game &g);
-
-		// Assignment operator
-		Game& operator=(const Game &game);
-
 		// Returns true if it is white's turn
 		bool turn_white() const { return is_white_turn; }
+
+		// Returns a 64-bit key identifying the piece placement and the player to move.
+		// The key is updated incrementally as moves are made, so this is constant time.
+		HashKey hash() const {
+			return board.key() ^ (is_white_turn ? 0 : zobrist_keys().black_to_move);
+		}
+
+		// Returns the number of moves by either player since the last capture or pawn move
+		int halfmove_clock() const { return halfmoves; }
+
+		// Returns the number of the current move, starting at 1 and counting up after black moves
+		int fullmove_number() const { return fullmoves; }
+
+		// Returns a const pointer to the piece at a position, or nullptr if it is empty
+		const Piece* piece_at(const Position& position) const { return board(position); }
+
+		// Returns the set of occupied squares
+		Bitboard occupancy() const { return board.occupancy(); }
+
+		// Returns true if the move takes an opposing piece
+		bool is_capture(const Move& move) const { return board.occupancy(!is_white_turn) & square_bb(move.to()); }
     
         	// Displays the game by printing it to stdout
 		void display() const { board.display(); }
@@ -31,21 +84,42 @@ namespace Chess {
 		bool is_valid_game() const { return board.has_valid_kings(); }
 
 		// Attempts to make a move. If successful, the move is made and
-		// the turn is switched white <-> black. Otherwise, an exception is thrown
+		// the turn is switched white <-> black. Otherwise, an exception is thrown.
+		// The move is looked up in the legal moves of status(), and only a move
+		// that is not there goes through validate_move to find the reason.
 		void make_move(const Position& start, const Position& end);
 
+		// Makes the same decisions as make_move without throwing or allocating.
+		// Returns MOVE_OK if the move is legal, or the reason it is not.
+		MoveError validate_move(const Position& start, const Position& end) const;
+
 		// Returns true if the designated player is in check
 		bool in_check(const bool& white) const;
 
+		// Returns the status of the position for the player to move. It is worked
+		// out on the first call and kept until the position changes, so asking
+		// again is free. The cache is not locked: do not call this on the same
+		// game from two threads at once.
+		const GameStatus& status() const;
+
 		// Test if the path is clear to the destination
 		bool is_path_clear(const Position& start, const Position& end) const;
 
 		// Is the path linear (diagonal, horizontal, vertical)
 		bool is_path_linear(const Position& start, const Position& end) const;
 
-		// Sees if a move will result in check
+		// Sees if a move will result in check. The move is tried on a copy of
+		// the board, so the game and its move history are not touched.
 		bool would_check(const Position &start, const Position &end) const;
 
+		// Plays a move produced by the move generator on this board, without
+		// checking it, and switches the turn. The information needed to take
+		// the move back is pushed onto an undo stack.
+		void do_move(const Move& move);
+
+		// Takes back the most recent move played with do_move
+		void undo_move();
+
 		// determines if a piece is elligible to be promoted
 		bool check_promotion(const Position& start, const Position& end) const;
 
@@ -55,6 +129,18 @@ namespace Chess {
 		// Tries to see if a player can move to allow king to escape from check
 		bool prevent_check(const Position& pos) const;
 
+		// Returns every move the player to move could make if leaving their own
+		// king in check were allowed
+		MoveList generate_pseudo_legal_moves() const;
+
+		// Returns every legal move for the player to move
+		MoveList generate_legal_moves() const;
+
+		// Finds the legal move written as Move::uci_name() writes it. A promotion
+		// may leave out its 'q', since pawns always become queens; any other
+		// promotion piece is not a legal move here. Returns false if there is none.
+		bool find_uci_move(std::string_view text, Move& move) const;
+
 		// Returns true if the designated player is in mate
 		bool in_mate(const bool& white) const;
 
@@ -64,19 +150,72 @@ namespace Chess {
         	// Returns the total material point value of the designated player
         	int point_value(const bool& white) const;
 
-		// Destructor
-		~Game();
+		// Returns the positional evaluation in centipawns, from the point of view of
+		// the player to move: material and piece-square tables blended by game phase,
+		// plus mobility and pawn structure
+		int evaluate() const { return Chess::evaluate(board, is_white_turn); }
+
+		// Replaces the position with the one described by a FEN record. The
+		// placement, side to move, castling, en passant and move counter fields
+		// are read straight from the buffer; the last four fields may be left out.
+		// Castling rights and en passant targets are checked for form but have no
+		// effect, since this game does not allow those moves. Throws an exception
+		// and leaves the game unchanged if the record is malformed.
+		void load_fen(std::string_view fen);
 
-        	// Run cleanup for Board.cpp
-        	void cleanup();
+		// Returns the position as a FEN record. Castling and en passant are
+		// always written as '-'.
+		std::string to_fen() const;
+
+		// Returns the position in the 32-byte packed form. Throws an exception if
+		// there are more than PackedPosition::MAX_PIECES pieces on the board.
+		PackedPosition to_packed() const;
+
+		// Replaces the position with a packed one. Throws an exception and leaves
+		// the game unchanged if the record is not one that to_packed could write.
+		void from_packed(const PackedPosition& packed);
 
 	private:
+		// Adds the moves of the designated player, following each piece's movement pattern
+		void add_pseudo_legal_moves(const bool& white, MoveList& moves) const;
+
+		// Adds the moves of the designated player that do not leave their king in check
+		void add_legal_moves(const bool& white, MoveList& moves) const;
+
+		// Returns the set of the designated player's pieces that attack the square
+		Bitboard attackers_to(int square, bool by_white) const;
+
+		// What do_move changed, so that undo_move can restore it
+		struct UndoRecord {
+			Move move;
+
+			// Designator of the piece that moved, before any promotion
+			char moved;
+
+			// Designator of the captured piece, or 0 for a quiet move
+			char captured;
+
+			// The halfmove clock before the move
+			int halfmoves;
+		};
+
 		// The board
 		Board board;
 
 		// Is it white's turn?
 		bool is_white_turn;
 
+		// Moves since the last capture or pawn move, and the current move number
+		int halfmoves;
+		int fullmoves;
+
+		// Moves played with do_move that can still be taken back
+		std::vector<UndoRecord> history;
+
+		// The result of status(), valid until the position changes
+		mutable GameStatus cached_status;
+		mutable bool status_valid;
+
         	// Writes the board out to a stream
         	friend std::ostream& operator<< (std::ostream& os, const Game& game);
 
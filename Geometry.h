@@ -0,0 +1,173 @@
+#ifndef GEOMETRY_H
+#define GEOMETRY_H
+
+#include <cstdint>
+#include "Bitboard.h"
+
+namespace Chess {
+    // Tables of board geometry that never change: leaper attacks, empty-board
+    // rays, the squares between and along two squares, and square distances.
+    // They are computed by the compiler, so there is no startup cost and every
+    // query below is a single lookup.
+    namespace Geometry {
+        struct SquareSets {
+            Bitboard sets[64];
+        };
+
+        struct SquarePairSets {
+            Bitboard sets[64][64];
+        };
+
+        struct SquarePairDistances {
+            std::uint8_t distance[64][64];
+        };
+
+        constexpr int column(int square) { return square % 8; }
+        constexpr int row(int square) { return square / 8; }
+
+        constexpr int abs_diff(int a, int b) { return a < b ? b - a : a - b; }
+
+        constexpr bool inside(int col, int r) { return col >= 0 && col < 8 && r >= 0 && r < 8; }
+
+        // Sets of squares reached by single steps from each square
+        template <int COUNT>
+        constexpr SquareSets make_steps(const int (&steps)[COUNT][2]) {
+            SquareSets table{};
+            for (int sq = 0; sq < 64; sq++) {
+                for (int i = 0; i < COUNT; i++) {
+                    int col = column(sq) + steps[i][0];
+                    int r = row(sq) + steps[i][1];
+                    if (inside(col, r)) {
+                        table.sets[sq] |= Bitboard(1) << (r * 8 + col);
+                    }
+                }
+            }
+            return table;
+        }
+
+        // Sets of squares reached by sliding along the given directions on an empty board
+        constexpr SquareSets make_rays(const int (&directions)[4][2]) {
+            SquareSets table{};
+            for (int sq = 0; sq < 64; sq++) {
+                for (int dir = 0; dir < 4; dir++) {
+                    int col = column(sq) + directions[dir][0];
+                    int r = row(sq) + directions[dir][1];
+                    while (inside(col, r)) {
+                        table.sets[sq] |= Bitboard(1) << (r * 8 + col);
+                        col += directions[dir][0];
+                        r += directions[dir][1];
+                    }
+                }
+            }
+            return table;
+        }
+
+        // Whether two different squares share a row, column or diagonal
+        constexpr bool aligned(int a, int b) {
+            return a != b && (column(a) == column(b) || row(a) == row(b)
+                              || abs_diff(column(a), column(b)) == abs_diff(row(a), row(b)));
+        }
+
+        constexpr int step_towards(int from, int to) { return from < to ? 1 : (from > to ? -1 : 0); }
+
+        // Squares strictly between two aligned squares
+        constexpr SquarePairSets make_between() {
+            SquarePairSets table{};
+            for (int a = 0; a < 64; a++) {
+                for (int b = 0; b < 64; b++) {
+                    if (!aligned(a, b)) {
+                        continue;
+                    }
+                    int dc = step_towards(column(a), column(b));
+                    int dr = step_towards(row(a), row(b));
+                    int col = column(a) + dc;
+                    int r = row(a) + dr;
+                    while (r * 8 + col != b) {
+                        table.sets[a][b] |= Bitboard(1) << (r * 8 + col);
+                        col += dc;
+                        r += dr;
+                    }
+                }
+            }
+            return table;
+        }
+
+        // The whole row, column or diagonal through two aligned squares, edge to edge
+        constexpr SquarePairSets make_lines() {
+            SquarePairSets table{};
+            for (int a = 0; a < 64; a++) {
+                for (int b = 0; b < 64; b++) {
+                    if (!aligned(a, b)) {
+                        continue;
+                    }
+                    int dc = step_towards(column(a), column(b));
+                    int dr = step_towards(row(a), row(b));
+                    int col = column(a);
+                    int r = row(a);
+                    while (inside(col - dc, r - dr)) {
+                        col -= dc;
+                        r -= dr;
+                    }
+                    while (inside(col, r)) {
+                        table.sets[a][b] |= Bitboard(1) << (r * 8 + col);
+                        col += dc;
+                        r += dr;
+                    }
+                }
+            }
+            return table;
+        }
+
+        // Number of king steps between two squares
+        constexpr SquarePairDistances make_distances() {
+            SquarePairDistances table{};
+            for (int a = 0; a < 64; a++) {
+                for (int b = 0; b < 64; b++) {
+                    int dc = abs_diff(column(a), column(b));
+                    int dr = abs_diff(row(a), row(b));
+                    table.distance[a][b] = static_cast<std::uint8_t>(dc > dr ? dc : dr);
+                }
+            }
+            return table;
+        }
+
+        constexpr int KNIGHT_STEPS[8][2] = { {1, 2}, {2, 1}, {2, -1}, {1, -2}, {-1, -2}, {-2, -1}, {-2, 1}, {-1, 2} };
+        constexpr int KING_STEPS[8][2] = { {1, 0}, {1, 1}, {0, 1}, {-1, 1}, {-1, 0}, {-1, -1}, {0, -1}, {1, -1} };
+        constexpr int WHITE_PAWN_STEPS[2][2] = { {-1, 1}, {1, 1} };
+        constexpr int BLACK_PAWN_STEPS[2][2] = { {-1, -1}, {1, -1} };
+        constexpr int ROOK_DIRECTIONS[4][2] = { {1, 0}, {0, 1}, {-1, 0}, {0, -1} };
+        constexpr int BISHOP_DIRECTIONS[4][2] = { {1, 1}, {-1, 1}, {-1, -1}, {1, -1} };
+
+        inline constexpr SquareSets KNIGHT_ATTACKS = make_steps(KNIGHT_STEPS);
+        inline constexpr SquareSets KING_ATTACKS = make_steps(KING_STEPS);
+        inline constexpr SquareSets PAWN_ATTACKS[2] = { make_steps(WHITE_PAWN_STEPS), make_steps(BLACK_PAWN_STEPS) };
+        inline constexpr SquareSets ROOK_RAYS = make_rays(ROOK_DIRECTIONS);
+        inline constexpr SquareSets BISHOP_RAYS = make_rays(BISHOP_DIRECTIONS);
+        inline constexpr SquarePairSets BETWEEN = make_between();
+        inline constexpr SquarePairSets LINES = make_lines();
+        inline constexpr SquarePairDistances DISTANCES = make_distances();
+    }
+
+    // Squares a knight or king on the square attacks
+    constexpr Bitboard knight_attacks(int square) { return Geometry::KNIGHT_ATTACKS.sets[square]; }
+    constexpr Bitboard king_attacks(int square) { return Geometry::KING_ATTACKS.sets[square]; }
+
+    // Squares a pawn of the given color on the square can capture on
+    constexpr Bitboard pawn_attacks(bool white, int square) { return Geometry::PAWN_ATTACKS[white ? 0 : 1].sets[square]; }
+
+    // Squares a rook or bishop on the square reaches on an empty board
+    constexpr Bitboard rook_rays(int square) { return Geometry::ROOK_RAYS.sets[square]; }
+    constexpr Bitboard bishop_rays(int square) { return Geometry::BISHOP_RAYS.sets[square]; }
+
+    // Squares strictly between two squares on a shared row, column or diagonal,
+    // or the empty set if the squares are not aligned
+    constexpr Bitboard between(int from, int to) { return Geometry::BETWEEN.sets[from][to]; }
+
+    // The full row, column or diagonal through two squares, or the empty set if
+    // the squares are not aligned
+    constexpr Bitboard line(int a, int b) { return Geometry::LINES.sets[a][b]; }
+
+    // Number of king steps between two squares
+    constexpr int distance(int a, int b) { return Geometry::DISTANCES.distance[a][b]; }
+}
+#endif // GEOMETRY_H
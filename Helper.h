@@ -1,7 +0,0 @@
-#ifndef HELPER_H
-#define HELPER_H
-
-// Absolute
-inline int ABS(int N){ return N < 0 ? -N : N; }
-
-#endif // HELPER_H
\ No newline at end of file
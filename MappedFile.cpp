@@ -0,0 +1,34 @@
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "MappedFile.h"
+
+namespace Chess {
+    MappedFile::MappedFile(const char* path) : data(nullptr), length(0) {
+        int fd = open(path, O_RDONLY);
+        if (fd < 0) {
+            return;
+        }
+        struct stat info;
+        if (fstat(fd, &info) == 0) {
+            if (info.st_size == 0) {
+                // An empty file has nothing to map but is not an error
+                data = "";
+            } else {
+                void* mapping = mmap(nullptr, static_cast<std::size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+                if (mapping != MAP_FAILED) {
+                    data = static_cast<const char*>(mapping);
+                    length = static_cast<std::size_t>(info.st_size);
+                }
+            }
+        }
+        close(fd);
+    }
+
+    MappedFile::~MappedFile() {
+        if (data != nullptr && length > 0) {
+            munmap(const_cast<char*>(data), length);
+        }
+    }
+}
@@ -0,0 +1,35 @@
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <cstddef>
+#include <string_view>
+
+namespace Chess {
+    // A file mapped read-only into memory for as long as the object lives. The
+    // operating system pages the contents in on demand, so opening even a very
+    // large file is cheap and reading it does not copy it.
+    class MappedFile {
+
+    public:
+        // Maps the file, or leaves the object closed if it cannot be opened.
+        // An empty file opens successfully with empty contents.
+        explicit MappedFile(const char* path);
+
+        ~MappedFile();
+
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+
+        bool is_open() const { return data != nullptr; }
+
+        // The bytes of the file
+        std::string_view contents() const { return std::string_view(data, length); }
+
+        std::size_t size() const { return length; }
+
+    private:
+        const char* data;
+        std::size_t length;
+    };
+}
+#endif // MAPPED_FILE_H
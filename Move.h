@@ -0,0 +1,117 @@
+#ifndef MOVE_H
+#define MOVE_H
+
+#include <cstdint>
+#include <string>
+#include "Piece.h"
+#include "Bitboard.h"
+
+namespace Chess {
+	// A move packed into 16 bits: the start square, the end square and whether
+	// the moving pawn is promoted. Squares are numbered as in Bitboard.h.
+	class Move {
+
+	public:
+		// The null move, which is never generated for a real position
+		Move() : data(0) {}
+
+		Move(int from, int to, bool promotion = false)
+			: data(static_cast<std::uint16_t>(from | (to << 6) | (promotion ? 1 << 12 : 0))) {}
+
+		// Start and end squares
+		int from() const { return data & 0x3F; }
+		int to() const { return (data >> 6) & 0x3F; }
+
+		// Start and end positions, in the form used by Game::make_move
+		Position start() const { return position_of(from()); }
+		Position end() const { return position_of(to()); }
+
+		// Returns the move in the four character form accepted by the 'M' command, e.g. "E2E4"
+		std::string name() const {
+			std::string text;
+			text += start().first;
+			text += start().second;
+			text += end().first;
+			text += end().second;
+			return text;
+		}
+
+		// Returns the move as UCI writes it, in lower case with a trailing 'q' for
+		// promotions, e.g. "e2e4" and "e7e8q", or "0000" for the null move
+		std::string uci_name() const {
+			if (data == 0) {
+				return "0000";
+			}
+			std::string text = name();
+			for (char& c : text) {
+				if (c >= 'A' && c <= 'Z') {
+					c = static_cast<char>(c - 'A' + 'a');
+				}
+			}
+			if (is_promotion()) {
+				text += 'q';
+			}
+			return text;
+		}
+
+		// Returns true if the moving pawn reaches the last row and becomes a queen
+		bool is_promotion() const { return (data >> 12) & 1; }
+
+		// Returns the packed representation
+		std::uint16_t raw() const { return data; }
+
+		// Rebuilds a move from its packed representation
+		static Move from_raw(std::uint16_t raw) {
+			Move move;
+			move.data = raw;
+			return move;
+		}
+
+		bool operator==(const Move& o) const { return data == o.data; }
+		bool operator!=(const Move& o) const { return data != o.data; }
+
+	private:
+		std::uint16_t data;
+	};
+
+	// A fixed-capacity list of moves that lives on the stack, so generating
+	// moves never touches the heap. The capacity covers any position that can
+	// be loaded from a file, not only positions reachable in a real game.
+	class MoveList {
+
+	public:
+		static const int CAPACITY = 1024;
+
+		MoveList() : count(0) {}
+
+		// Appends a move to the list
+		void add(const Move& move) { moves[count++] = move; }
+
+		// Removes every move from the list
+		void clear() { count = 0; }
+
+		int size() const { return count; }
+		bool empty() const { return count == 0; }
+
+		const Move& operator[](int i) const { return moves[i]; }
+		Move& operator[](int i) { return moves[i]; }
+
+		const Move* begin() const { return moves; }
+		const Move* end() const { return moves + count; }
+
+		// Returns true if the list holds a move from start to end
+		bool contains(const Position& start, const Position& end) const {
+			for (int i = 0; i < count; i++) {
+				if (moves[i].start() == start && moves[i].end() == end) {
+					return true;
+				}
+			}
+			return false;
+		}
+
+	private:
+		Move moves[CAPACITY];
+		int count;
+	};
+}
+#endif // MOVE_H
@@ -0,0 +1,70 @@
+#ifndef OPENING_BOOK_H
+#define OPENING_BOOK_H
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include "Game.h"
+#include "MappedFile.h"
+#include "Move.h"
+
+namespace Chess {
+    // An opening book in the Polyglot .bin format: a file of 16-byte entries,
+    // sorted by position key, each holding a move and a weight. The file is
+    // memory-mapped and searched in place, so a lookup is a binary search with
+    // no heap allocation.
+    //
+    // Polyglot keys are built from a fixed table of 781 published random
+    // numbers, which are not the keys of Zobrist.h; the table is built into
+    // OpeningBook.cpp.
+    //
+    // Castling and en passant do not exist in this game, but books are built from
+    // standard chess, so a king and rook still on their home squares are keyed as
+    // if they could castle; otherwise no early position would be found in the
+    // book. En passant keys are never used, and book moves that castle, capture en
+    // passant or underpromote are skipped.
+    class OpeningBook {
+
+    public:
+        // Number of random numbers that make up a Polyglot key
+        static const int KEY_COUNT = 781;
+
+        OpeningBook();
+
+        OpeningBook(const OpeningBook&) = delete;
+        OpeningBook& operator=(const OpeningBook&) = delete;
+
+        // Maps the book. Returns false, leaving the book closed, if the file
+        // cannot be read or is not a whole number of entries.
+        bool open(const std::string& book_path);
+
+        // Unmaps the book
+        void close();
+
+        bool is_open() const { return file != nullptr; }
+
+        // Returns the number of entries in the book
+        std::size_t size() const;
+
+        // Returns the Polyglot key of the position. Mystery pieces have no
+        // Polyglot key and are left out. Each castling key is included when the
+        // king and that rook are on their starting squares.
+        std::uint64_t key(const Game& game) const;
+
+        // Looks up the position and picks one of its book moves found in legal,
+        // the legal moves of the position, at random in proportion to the
+        // weights. Returns false if the position is not in the book. Not safe to
+        // call from several threads at once, since the random number generator
+        // is shared.
+        bool probe(const Game& game, const MoveList& legal, Move& move) const;
+
+    private:
+        // Returns the index of the first entry whose key is not less than key
+        std::size_t lower_bound(std::uint64_t key) const;
+
+        std::unique_ptr<MappedFile> file;
+        const unsigned char* entries;
+        mutable std::uint64_t random_state;
+    };
+}
+#endif // OPENING_BOOK_H
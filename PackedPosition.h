@@ -0,0 +1,56 @@
+#ifndef PACKED_POSITION_H
+#define PACKED_POSITION_H
+
+#include <cstdint>
+#include "Bitboard.h"
+
+namespace Chess {
+    // A position in a fixed 32 bytes, for storing very many of them. All
+    // numbers are little-endian and the struct is only bytes, so records can
+    // be read in place from a memory-mapped file on any machine.
+    //   bytes 0-7    occupancy: bit n is set if square n (A1 = 0) holds a piece
+    //   bytes 8-23   one 4-bit piece_index() per occupied square, lowest square
+    //                first, in the low nibble of each byte before the high one;
+    //                unused nibbles are 0
+    //   byte 24      bit 0 set if black is to move, the other bits 0
+    //   byte 25      halfmove clock, at most 255
+    //   bytes 26-27  fullmove number, at most 65535
+    //   bytes 28-31  0
+    // A position with more than 32 pieces, which needs mystery pieces or an
+    // unusual setup, cannot be packed.
+    struct PackedPosition {
+        std::uint8_t bytes[32];
+
+        // Most pieces a packed position can hold
+        static const int MAX_PIECES = 32;
+
+        Bitboard occupancy() const {
+            Bitboard occupied = 0;
+            for (int i = 7; i >= 0; i--) {
+                occupied = (occupied << 8) | bytes[i];
+            }
+            return occupied;
+        }
+
+        // The piece index of the n-th occupied square, counting from A1
+        int piece(int n) const { return (bytes[8 + n / 2] >> (n % 2 == 0 ? 0 : 4)) & 0x0F; }
+
+        bool white_to_move() const { return (bytes[24] & 1) == 0; }
+
+        int halfmove_clock() const { return bytes[25]; }
+
+        int fullmove_number() const { return bytes[26] | (bytes[27] << 8); }
+
+        bool operator==(const PackedPosition& o) const {
+            for (int i = 0; i < 32; i++) {
+                if (bytes[i] != o.bytes[i]) {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        bool operator!=(const PackedPosition& o) const { return !(*this == o); }
+    };
+}
+#endif // PACKED_POSITION_H
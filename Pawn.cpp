@@ -1,5 +1,5 @@
 #include "Pawn.h"
-#include "Helper.h"
+#include "Geometry.h"
 
 namespace Chess {
     bool Pawn::legal_move_shape(const Position& start, const Position& end) const {
@@ -41,16 +41,7 @@ namespace Chess {
 
     bool Pawn::legal_capture_shape(const Position &start, const Position &end) const {
 
-        // Forward Diagonal if white
-        if (is_white()) {
-            if (ABS(end.first - start.first) == 1 && end.second - start.second == 1) {
-                return true;
-            }
-        } else {
-            if (ABS(end.first - start.first) == 1 && start.second - end.second == 1) {
-                return true;
-            }
-        }
-        return false;
+        // Forward Diagonal, looked up in the pawn attack table for this color
+        return (pawn_attacks(is_white(), square_of(start)) & square_bb(square_of(end))) != 0;
     }
 }
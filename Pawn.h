@@ -20,7 +20,7 @@ namespace Chess {
 	private:
 		Pawn(bool is_white) : Piece(is_white) {}
 
-		friend Piece* create_piece(const char& piece_designator);
+		friend const Piece* create_piece(const char& piece_designator);
 	};
 }
 #endif // PAWN_H
@@ -0,0 +1,259 @@
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <unordered_map>
+#include "Exceptions.h"
+#include "PositionDatabase.h"
+
+namespace Chess {
+    // Piece types in signature order, and the letters of each type
+    static const PieceType SIGNATURE_TYPES[7] = { KING, QUEEN, ROOK, BISHOP, KNIGHT, PAWN, MYSTERY };
+    static const char WHITE_LETTERS[] = "PNBRQKM";
+    static const char BLACK_LETTERS[] = "pnbrqkm";
+
+    static std::uint64_t read_number(const unsigned char* bytes, int size) {
+        std::uint64_t value = 0;
+        for (int i = size - 1; i >= 0; i--) {
+            value = (value << 8) | bytes[i];
+        }
+        return value;
+    }
+
+    static void write_number(std::ofstream& out, std::uint64_t value, int size) {
+        char bytes[8];
+        for (int i = 0; i < size; i++) {
+            bytes[i] = static_cast<char>((value >> (8 * i)) & 0xFF);
+        }
+        out.write(bytes, size);
+    }
+
+    HashKey packed_key(const PackedPosition& position) {
+        const ZobristKeys& keys = zobrist_keys();
+        HashKey key = position.white_to_move() ? 0 : keys.black_to_move;
+        Bitboard occupied = position.occupancy();
+        for (int n = 0; occupied; n++) {
+            key ^= keys.pieces[position.piece(n)][pop_lsb(occupied)];
+        }
+        return key;
+    }
+
+    std::string material_signature(const PackedPosition& position) {
+        int counts[PIECE_TYPES] = { 0 };
+        int pieces = pop_count(position.occupancy());
+        for (int n = 0; n < pieces; n++) {
+            counts[position.piece(n)]++;
+        }
+
+        std::string signature;
+        for (int i = 0; i < 7; i++) {
+            signature.append(counts[piece_index(SIGNATURE_TYPES[i], true)], WHITE_LETTERS[SIGNATURE_TYPES[i]]);
+        }
+        for (int i = 0; i < 7; i++) {
+            signature.append(counts[piece_index(SIGNATURE_TYPES[i], false)], BLACK_LETTERS[SIGNATURE_TYPES[i]]);
+        }
+        return signature;
+    }
+
+    bool PositionDatabaseBuilder::write(const std::string& path) const {
+        const std::uint64_t rows = positions.size();
+        if (rows > 0xFFFFFFFFULL) {
+            return false;
+        }
+
+        // Rows in key order
+        std::vector<std::pair<HashKey, std::uint32_t> > order(rows);
+        for (std::uint64_t i = 0; i < rows; i++) {
+            order[i] = std::make_pair(packed_key(positions[i]), static_cast<std::uint32_t>(i));
+        }
+        std::sort(order.begin(), order.end());
+
+        // Signature of every row, numbered in first-seen order and then sorted by name
+        std::unordered_map<std::string, std::uint32_t> ids;
+        std::vector<std::string> names;
+        std::vector<std::uint32_t> row_signature(rows);
+        for (std::uint64_t row = 0; row < rows; row++) {
+            std::string name = material_signature(positions[order[row].second]);
+            std::unordered_map<std::string, std::uint32_t>::iterator it = ids.find(name);
+            if (it == ids.end()) {
+                it = ids.emplace(name, static_cast<std::uint32_t>(names.size())).first;
+                names.push_back(name);
+            }
+            row_signature[row] = it->second;
+        }
+        std::vector<std::uint32_t> by_name(names.size());
+        for (std::uint32_t id = 0; id < by_name.size(); id++) {
+            by_name[id] = id;
+        }
+        std::sort(by_name.begin(), by_name.end(),
+                  [&names](std::uint32_t a, std::uint32_t b) { return names[a] < names[b]; });
+
+        // Counting sort of the row numbers by signature
+        std::vector<std::uint64_t> first(names.size() + 1, 0);
+        std::vector<std::uint32_t> rank(names.size());
+        for (std::uint32_t r = 0; r < by_name.size(); r++) {
+            rank[by_name[r]] = r;
+        }
+        for (std::uint64_t row = 0; row < rows; row++) {
+            first[rank[row_signature[row]] + 1]++;
+        }
+        for (std::size_t r = 1; r < first.size(); r++) {
+            first[r] += first[r - 1];
+        }
+        std::vector<std::uint32_t> grouped(rows);
+        std::vector<std::uint64_t> next(first.begin(), first.end() - 1);
+        for (std::uint64_t row = 0; row < rows; row++) {
+            grouped[next[rank[row_signature[row]]]++] = static_cast<std::uint32_t>(row);
+        }
+
+        const std::uint64_t keys_offset = POSITION_DATABASE_HEADER_SIZE;
+        const std::uint64_t records_offset = keys_offset + 8 * rows;
+        const std::uint64_t by_material_offset = records_offset + sizeof(PackedPosition) * rows;
+        const std::uint64_t signatures_offset = by_material_offset + ((4 * rows + 7) & ~std::uint64_t(7));
+
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        if (!out) {
+            return false;
+        }
+        out.write("CHDB", 4);
+        write_number(out, 1, 4);
+        write_number(out, rows, 8);
+        write_number(out, names.size(), 8);
+        write_number(out, keys_offset, 8);
+        write_number(out, records_offset, 8);
+        write_number(out, by_material_offset, 8);
+        write_number(out, signatures_offset, 8);
+        write_number(out, 0, 8);
+
+        for (std::uint64_t row = 0; row < rows; row++) {
+            write_number(out, order[row].first, 8);
+        }
+        for (std::uint64_t row = 0; row < rows; row++) {
+            out.write(reinterpret_cast<const char*>(positions[order[row].second].bytes), sizeof(PackedPosition));
+        }
+        for (std::uint64_t row = 0; row < rows; row++) {
+            write_number(out, grouped[row], 4);
+        }
+        if (rows % 2 != 0) {
+            write_number(out, 0, 4);
+        }
+        for (std::uint32_t r = 0; r < by_name.size(); r++) {
+            char name[32] = { 0 };
+            std::memcpy(name, names[by_name[r]].data(), std::min<std::size_t>(names[by_name[r]].size(), sizeof(name)));
+            out.write(name, sizeof(name));
+            write_number(out, first[r], 8);
+            write_number(out, first[r + 1] - first[r], 8);
+        }
+        out.close();
+        return !out.fail();
+    }
+
+    PositionDatabase::PositionDatabase(const char* path)
+        : file(path), open(false), rows(0), signatures(0), keys(nullptr), records(nullptr),
+          by_material(nullptr), signature_table(nullptr) {
+        if (!file.is_open() || file.size() < POSITION_DATABASE_HEADER_SIZE) {
+            return;
+        }
+        const unsigned char* base = reinterpret_cast<const unsigned char*>(file.contents().data());
+        if (std::memcmp(base, "CHDB", 4) != 0 || read_number(base + 4, 4) != 1) {
+            return;
+        }
+
+        std::uint64_t row_count = read_number(base + 8, 8);
+        std::uint64_t signature_total = read_number(base + 16, 8);
+        std::uint64_t keys_offset = read_number(base + 24, 8);
+        std::uint64_t records_offset = read_number(base + 32, 8);
+        std::uint64_t by_material_offset = read_number(base + 40, 8);
+        std::uint64_t signatures_offset = read_number(base + 48, 8);
+
+        // Every section must lie inside the file
+        const std::uint64_t size = file.size();
+        if (row_count > 0xFFFFFFFFULL || signature_total > row_count
+            || keys_offset > size || 8 * row_count > size - keys_offset
+            || records_offset > size || sizeof(PackedPosition) * row_count > size - records_offset
+            || by_material_offset > size || 4 * row_count > size - by_material_offset
+            || signatures_offset > size || POSITION_DATABASE_SIGNATURE_SIZE * signature_total > size - signatures_offset) {
+            return;
+        }
+
+        // The signatures must split the by material section between them, in
+        // order and without gaps. The row numbers in it are checked as they are
+        // read, so opening does not touch the whole section.
+        const unsigned char* table = base + signatures_offset;
+        std::uint64_t expected_first = 0;
+        for (std::uint64_t i = 0; i < signature_total; i++) {
+            const unsigned char* entry = table + POSITION_DATABASE_SIGNATURE_SIZE * i;
+            std::uint64_t first = read_number(entry + 32, 8);
+            std::uint64_t count = read_number(entry + 40, 8);
+            if (first != expected_first || count > row_count - first) {
+                return;
+            }
+            expected_first += count;
+        }
+        if (expected_first != row_count) {
+            return;
+        }
+
+        rows = row_count;
+        signatures = signature_total;
+        keys = base + keys_offset;
+        records = reinterpret_cast<const PackedPosition*>(base + records_offset);
+        by_material = base + by_material_offset;
+        signature_table = table;
+        open = true;
+    }
+
+    HashKey PositionDatabase::key(std::uint64_t row) const {
+        return read_number(keys + 8 * row, 8);
+    }
+
+    std::pair<std::uint64_t, std::uint64_t> PositionDatabase::find_key(HashKey wanted) const {
+        // First row whose key is not less than the wanted one
+        std::uint64_t low = 0;
+        std::uint64_t high = rows;
+        while (low < high) {
+            std::uint64_t middle = low + (high - low) / 2;
+            if (key(middle) < wanted) {
+                low = middle + 1;
+            } else {
+                high = middle;
+            }
+        }
+        std::uint64_t last = low;
+        while (last < rows && key(last) == wanted) {
+            last++;
+        }
+        return std::make_pair(low, last);
+    }
+
+    std::string PositionDatabase::signature(std::uint64_t index) const {
+        const char* name = reinterpret_cast<const char*>(signature_table + POSITION_DATABASE_SIGNATURE_SIZE * index);
+        return std::string(name, strnlen(name, 32));
+    }
+
+    std::uint64_t PositionDatabase::signature_rows(std::uint64_t index) const {
+        return read_number(signature_table + POSITION_DATABASE_SIGNATURE_SIZE * index + 40, 8);
+    }
+
+    std::uint64_t PositionDatabase::find_signature(const std::string& name) const {
+        std::uint64_t low = 0;
+        std::uint64_t high = signatures;
+        while (low < high) {
+            std::uint64_t middle = low + (high - low) / 2;
+            if (signature(middle) < name) {
+                low = middle + 1;
+            } else {
+                high = middle;
+            }
+        }
+        return low < signatures && signature(low) == name ? low : signatures;
+    }
+
+    std::uint64_t PositionDatabase::signature_row(std::uint64_t index, std::uint64_t n) const {
+        std::uint64_t first = read_number(signature_table + POSITION_DATABASE_SIGNATURE_SIZE * index + 32, 8);
+        std::uint64_t row = read_number(by_material + 4 * (first + n), 4);
+        if (row >= rows) {
+            throw Exception("corrupt position database");
+        }
+        return row;
+    }
+}
@@ -0,0 +1,107 @@
+#ifndef POSITION_DATABASE_H
+#define POSITION_DATABASE_H
+
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+#include "MappedFile.h"
+#include "PackedPosition.h"
+#include "Zobrist.h"
+
+namespace Chess {
+    // An on-disk table of packed positions with two indexes: one by Zobrist key,
+    // to find every stored copy of a position, and one by material signature, to
+    // find every position with a given set of pieces. A signature lists white's
+    // pieces in upper case and then black's in lower case, each in the order
+    // KQRBNPM, e.g. "KRPkr" for king, rook and pawn against king and rook.
+    //
+    // The file is written once by PositionDatabaseBuilder and then memory-mapped
+    // by PositionDatabase, so a lookup is a binary search over the mapping with
+    // nothing loaded up front. All numbers are little-endian. The file holds:
+    //   a 64-byte header: "CHDB", the version (1) as a 32-bit number, then as
+    //     64-bit numbers the row count, the signature count and the offsets of
+    //     the four sections below, and 8 zero bytes
+    //   keys:        one 64-bit Zobrist key per row, in increasing order
+    //   records:     one 32-byte PackedPosition per row, in the same order
+    //   by material: 32-bit row numbers, grouped by signature in signature order
+    //   signatures:  48 bytes each, in increasing name order: the name padded with
+    //                zero bytes to 32 characters, then as 64-bit numbers the index
+    //                of its first row number in the by material section and the
+    //                number of rows
+
+    const std::size_t POSITION_DATABASE_HEADER_SIZE = 64;
+    const std::size_t POSITION_DATABASE_SIGNATURE_SIZE = 48;
+
+    // Returns the Zobrist key of a packed position, the same as Game::hash()
+    HashKey packed_key(const PackedPosition& position);
+
+    // Returns the material signature of a packed position
+    std::string material_signature(const PackedPosition& position);
+
+    // Collects positions in memory and writes them out as an indexed file
+    class PositionDatabaseBuilder {
+
+    public:
+        void add(const PackedPosition& position) { positions.push_back(position); }
+
+        std::uint64_t size() const { return positions.size(); }
+
+        // Sorts and indexes the positions and writes the file. Returns false if
+        // it cannot be written or there are too many rows for 32-bit row numbers.
+        bool write(const std::string& path) const;
+
+    private:
+        std::vector<PackedPosition> positions;
+    };
+
+    // Reads an indexed position file
+    class PositionDatabase {
+
+    public:
+        // Maps the file, or leaves the object closed if it is not a position
+        // database. The section sizes and the signature table are checked, so a
+        // damaged file is refused rather than read past its end.
+        explicit PositionDatabase(const char* path);
+
+        PositionDatabase(const PositionDatabase&) = delete;
+        PositionDatabase& operator=(const PositionDatabase&) = delete;
+
+        bool is_open() const { return open; }
+
+        // Number of rows
+        std::uint64_t size() const { return rows; }
+
+        // The position and key stored in a row
+        const PackedPosition& record(std::uint64_t row) const { return records[row]; }
+        HashKey key(std::uint64_t row) const;
+
+        // Returns the rows [first, last) whose key is the given one. They are the
+        // same position unless two positions share a key, which callers can check
+        // by comparing records.
+        std::pair<std::uint64_t, std::uint64_t> find_key(HashKey key) const;
+
+        // Number of distinct signatures, and the name and row count of each
+        std::uint64_t signature_count() const { return signatures; }
+        std::string signature(std::uint64_t index) const;
+        std::uint64_t signature_rows(std::uint64_t index) const;
+
+        // Returns the index of the signature, or signature_count() if no row has it
+        std::uint64_t find_signature(const std::string& name) const;
+
+        // The n-th row with the signature at the given index. Throws an
+        // exception if the stored row number is not a row of the file.
+        std::uint64_t signature_row(std::uint64_t index, std::uint64_t n) const;
+
+    private:
+        MappedFile file;
+        bool open;
+        std::uint64_t rows;
+        std::uint64_t signatures;
+        const unsigned char* keys;
+        const PackedPosition* records;
+        const unsigned char* by_material;
+        const unsigned char* signature_table;
+    };
+}
+#endif // POSITION_DATABASE_H
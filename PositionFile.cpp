@@ -0,0 +1,65 @@
+#include <cstring>
+#include "PositionFile.h"
+
+namespace Chess {
+    static_assert(sizeof(PackedPosition) == 32 && alignof(PackedPosition) == 1,
+                  "packed positions are read in place from the file");
+
+    PositionFile::PositionFile(const char* path) : file(path), records(nullptr), count(0) {
+        if (!file.is_open() || file.size() < POSITION_FILE_HEADER_SIZE) {
+            return;
+        }
+        const unsigned char* header = reinterpret_cast<const unsigned char*>(file.contents().data());
+        if (std::memcmp(header, "CHPK", 4) != 0) {
+            return;
+        }
+        std::uint32_t record_size = 0;
+        for (int i = 7; i >= 4; i--) {
+            record_size = (record_size << 8) | header[i];
+        }
+        std::uint64_t records_in_header = 0;
+        for (int i = 15; i >= 8; i--) {
+            records_in_header = (records_in_header << 8) | header[i];
+        }
+        if (record_size != sizeof(PackedPosition)
+            || records_in_header > (file.size() - POSITION_FILE_HEADER_SIZE) / sizeof(PackedPosition)) {
+            return;
+        }
+        records = reinterpret_cast<const PackedPosition*>(file.contents().data() + POSITION_FILE_HEADER_SIZE);
+        count = records_in_header;
+    }
+
+    bool PositionWriter::open(const std::string& path) {
+        close();
+        out.open(path, std::ios::binary | std::ios::trunc);
+        count = 0;
+        if (!out) {
+            return false;
+        }
+        write_header();
+        return static_cast<bool>(out);
+    }
+
+    void PositionWriter::write_header() {
+        char header[POSITION_FILE_HEADER_SIZE] = { 'C', 'H', 'P', 'K' };
+        std::uint32_t record_size = sizeof(PackedPosition);
+        for (int i = 0; i < 4; i++) {
+            header[4 + i] = static_cast<char>((record_size >> (8 * i)) & 0xFF);
+        }
+        for (int i = 0; i < 8; i++) {
+            header[8 + i] = static_cast<char>((count >> (8 * i)) & 0xFF);
+        }
+        out.write(header, sizeof(header));
+    }
+
+    bool PositionWriter::close() {
+        if (!out.is_open()) {
+            return true;
+        }
+        out.seekp(0);
+        write_header();
+        bool ok = static_cast<bool>(out);
+        out.close();
+        return ok && !out.fail();
+    }
+}
@@ -0,0 +1,83 @@
+#ifndef POSITION_FILE_H
+#define POSITION_FILE_H
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include "MappedFile.h"
+#include "PackedPosition.h"
+
+namespace Chess {
+    // A file of packed positions. It starts with a 16-byte header: the four
+    // characters "CHPK", the record size (32) as a little-endian 32-bit number
+    // and the number of records as a little-endian 64-bit number. The records
+    // follow back to back, so record n starts at byte 16 + 32 * n.
+
+    const std::size_t POSITION_FILE_HEADER_SIZE = 16;
+
+    // Reads a position file by mapping it, so the records are used where they
+    // lie in the mapping and never copied
+    class PositionFile {
+
+    public:
+        // Maps the file, or leaves the object closed if it cannot be read or is
+        // not a position file
+        explicit PositionFile(const char* path);
+
+        PositionFile(const PositionFile&) = delete;
+        PositionFile& operator=(const PositionFile&) = delete;
+
+        bool is_open() const { return records != nullptr; }
+
+        // Number of records
+        std::uint64_t size() const { return count; }
+
+        const PackedPosition& operator[](std::uint64_t index) const { return records[index]; }
+
+        const PackedPosition* begin() const { return records; }
+        const PackedPosition* end() const { return records + count; }
+
+    private:
+        MappedFile file;
+        const PackedPosition* records;
+        std::uint64_t count;
+    };
+
+    // Writes a position file one record at a time. The record count in the
+    // header is filled in by close(), so a file that was never closed reads
+    // as empty.
+    class PositionWriter {
+
+    public:
+        PositionWriter() : count(0) {}
+
+        // Closes the file if it is still open
+        ~PositionWriter() { close(); }
+
+        PositionWriter(const PositionWriter&) = delete;
+        PositionWriter& operator=(const PositionWriter&) = delete;
+
+        // Creates or truncates the file. Returns false if it cannot be written.
+        bool open(const std::string& path);
+
+        bool is_open() const { return out.is_open(); }
+
+        void write(const PackedPosition& position) {
+            out.write(reinterpret_cast<const char*>(position.bytes), sizeof(position.bytes));
+            count++;
+        }
+
+        // Number of records written so far
+        std::uint64_t size() const { return count; }
+
+        // Writes the header and closes the file. Returns false if any write failed.
+        bool close();
+
+    private:
+        std::ofstream out;
+        std::uint64_t count;
+
+        void write_header();
+    };
+}
+#endif // POSITION_FILE_H
@@ -1,19 +1,12 @@
 #include "Queen.h"
-#include "Helper.h"
+#include "Geometry.h"
 
 namespace Chess {
     bool Queen::legal_move_shape(const Position& start, const Position& end) const {
 
-        // Checks if queen moved either down/up a row/column
-        if (start.first == end.first || start.second == end.second) {
-            return true;
-        }
-
-        // Checks if piece moved in a diagonal
-        if (ABS(start.first - end.first) == ABS(start.second - end.second)) {
-            return true;
-        }
-
-        return false;
+        // Checks if queen moved along a row, column or diagonal
+        int from = square_of(start);
+        int to = square_of(end);
+        return from == to || ((rook_rays(from) | bishop_rays(from)) & square_bb(to)) != 0;
     }
 }
\ No newline at end of file
@@ -18,7 +18,7 @@ namespace Chess {
 	private:
 		Queen(bool is_white) : Piece(is_white) {}
 
-		friend Piece* create_piece(const char& piece_designator);
+		friend const Piece* create_piece(const char& piece_designator);
 	};
 }
 
@@ -1,14 +1,12 @@
 #include "Rook.h"
-#include "Helper.h"
+#include "Geometry.h"
 
 namespace Chess {
     bool Rook::legal_move_shape(const Position& start, const Position& end) const {
 
         //Return false if rook moves diagonally
-        if (start.first == end.first || start.second == end.second) {
-            return true;
-        }
-
-        return false;
+        int from = square_of(start);
+        int to = square_of(end);
+        return from == to || (rook_rays(from) & square_bb(to)) != 0;
     }
-}
\ No newline at end of file
+}
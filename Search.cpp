@@ -0,0 +1,388 @@
+#include <algorithm>
+#include <cstdlib>
+#include "Search.h"
+
+namespace Chess {
+    Search::Search(std::size_t hash_mb)
+        : table(hash_mb), stop_requested(false), helpers_stop(false), thread_count(1), book(nullptr), tablebases(nullptr) {}
+
+    int Search::evaluate(const Game& game) {
+        return game.evaluate();
+    }
+
+    // Mate scores are stored relative to the position rather than the root, so an
+    // entry stays correct when the position is reached at a different ply
+    int Search::score_to_table(int score, int ply) {
+        if (score > MATE_SCORE - MAX_MATE_PLIES) {
+            return score + ply;
+        }
+        if (score < -MATE_SCORE + MAX_MATE_PLIES) {
+            return score - ply;
+        }
+        return score;
+    }
+
+    int Search::score_from_table(int score, int ply) {
+        if (score > MATE_SCORE - MAX_MATE_PLIES) {
+            return score - ply;
+        }
+        if (score < -MATE_SCORE + MAX_MATE_PLIES) {
+            return score + ply;
+        }
+        return score;
+    }
+
+    unsigned long long Search::total_nodes() const {
+        unsigned long long total = 0;
+        for (const std::unique_ptr<Worker>& worker : workers) {
+            total += worker->nodes.load(std::memory_order_relaxed);
+        }
+        return total;
+    }
+
+    bool Search::should_stop(const Worker& worker) {
+        if (stop_requested) {
+            return true;
+        }
+
+        // Helpers run until the main thread is done
+        if (worker.id != 0) {
+            return helpers_stop;
+        }
+
+        // Limits only apply once a first iteration has given us a move to play
+        if (worker.root_depth <= 1) {
+            return false;
+        }
+
+        if (limits.nodes > 0 && total_nodes() >= limits.nodes) {
+            return true;
+        }
+
+        if (limits.time_ms > 0) {
+            std::chrono::steady_clock::duration elapsed = std::chrono::steady_clock::now() - start_time;
+            if (std::chrono::duration_cast<std::chrono::milliseconds>(elapsed).count() >= limits.time_ms) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Hash move first, then captures with the most valuable victim and least valuable
+    // attacker, then promotions, then the killer moves for this ply
+    void Search::order_moves(const Worker& worker, MoveList& moves, const Move& hash_move, int ply) const {
+        const Game& game = worker.game;
+        int scores[MoveList::CAPACITY];
+
+        for (int i = 0; i < moves.size(); i++) {
+            const Move& move = moves[i];
+            int score = 0;
+            if (move == hash_move) {
+                score = 1000000;
+            } else if (game.is_capture(move)) {
+                int victim = game.piece_at(move.end())->point_value();
+                int attacker = game.piece_at(move.start())->point_value();
+                score = 100000 + 100 * victim - attacker;
+            } else if (move.is_promotion()) {
+                score = 90000;
+            } else if (move == worker.killers[ply][0]) {
+                score = 80000;
+            } else if (move == worker.killers[ply][1]) {
+                score = 79000;
+            }
+            scores[i] = score;
+        }
+
+        // Insertion sort: lists are short and often nearly ordered already
+        for (int i = 1; i < moves.size(); i++) {
+            Move move = moves[i];
+            int score = scores[i];
+            int j = i - 1;
+            while (j >= 0 && scores[j] < score) {
+                moves[j + 1] = moves[j];
+                scores[j + 1] = scores[j];
+                j--;
+            }
+            moves[j + 1] = move;
+            scores[j + 1] = score;
+        }
+    }
+
+    void Search::count_node(Worker& worker) {
+        unsigned long long nodes = worker.nodes.load(std::memory_order_relaxed) + 1;
+        worker.nodes.store(nodes, std::memory_order_relaxed);
+
+        // stop() is a single relaxed load, so it is honoured at once; the limits
+        // need a clock read or a sum over threads and are checked less often
+        if (stop_requested.load(std::memory_order_relaxed) || ((nodes & 1023) == 0 && should_stop(worker))) {
+            worker.aborted = true;
+        }
+    }
+
+    int Search::quiescence(Worker& worker, int alpha, int beta, int ply) {
+        worker.pv_length[ply] = ply;
+        count_node(worker);
+        if (worker.aborted) {
+            return 0;
+        }
+
+        Game& game = worker.game;
+        int stand_pat = evaluate(game);
+        if (ply >= MAX_PLY - 1 || stand_pat >= beta) {
+            return stand_pat;
+        }
+        if (stand_pat > alpha) {
+            alpha = stand_pat;
+        }
+
+        const bool white = game.turn_white();
+        MoveList all = game.generate_pseudo_legal_moves();
+        MoveList moves;
+        for (const Move& move : all) {
+            if (game.is_capture(move) || move.is_promotion()) {
+                moves.add(move);
+            }
+        }
+        order_moves(worker, moves, Move(), ply);
+
+        for (const Move& move : moves) {
+            game.do_move(move);
+            if (game.in_check(white)) {
+                game.undo_move();
+                continue;
+            }
+            int score = -quiescence(worker, -beta, -alpha, ply + 1);
+            game.undo_move();
+
+            if (worker.aborted) {
+                return 0;
+            }
+            if (score > alpha) {
+                if (score >= beta) {
+                    return score;
+                }
+                alpha = score;
+            }
+        }
+        return alpha;
+    }
+
+    int Search::negamax(Worker& worker, int depth, int alpha, int beta, int ply) {
+        worker.pv_length[ply] = ply;
+        if (depth <= 0) {
+            return quiescence(worker, alpha, beta, ply);
+        }
+
+        Game& game = worker.game;
+        if (ply >= MAX_PLY - 1) {
+            return evaluate(game);
+        }
+
+        count_node(worker);
+        if (worker.aborted) {
+            return 0;
+        }
+
+        // A tablebase gives the exact outcome, with the distance to mate
+        TablebaseResult endgame;
+        if (ply > 0 && tablebases != nullptr && pop_count(game.occupancy()) <= tablebases->max_pieces()
+            && tablebases->probe(game, endgame)) {
+            if (endgame.outcome == 0) {
+                return 0;
+            }
+            int mate = MATE_SCORE - ply - endgame.plies;
+            return endgame.outcome > 0 ? mate : -mate;
+        }
+
+        const bool white = game.turn_white();
+        const bool check = game.in_check(white);
+
+        // Look one move further when in check, so mates are not cut off at the horizon
+        if (check) {
+            depth++;
+        }
+
+        const int original_alpha = alpha;
+        const HashKey key = game.hash();
+        Move hash_move;
+        TTEntry entry;
+        if (table.probe(key, entry)) {
+            hash_move = entry.move;
+            if (ply > 0 && entry.depth >= depth) {
+                int score = score_from_table(entry.score, ply);
+                if (entry.bound == BOUND_EXACT
+                    || (entry.bound == BOUND_LOWER && score >= beta)
+                    || (entry.bound == BOUND_UPPER && score <= alpha)) {
+                    return score;
+                }
+            }
+        }
+
+        MoveList moves = game.generate_pseudo_legal_moves();
+        order_moves(worker, moves, hash_move, ply);
+
+        int best_score = -INFINITE_SCORE;
+        Move best_move;
+        int legal_moves = 0;
+
+        for (const Move& move : moves) {
+            const bool capture = game.is_capture(move);
+            game.do_move(move);
+            if (game.in_check(white)) {
+                game.undo_move();
+                continue;
+            }
+            legal_moves++;
+            int score = -negamax(worker, depth - 1, -beta, -alpha, ply + 1);
+            game.undo_move();
+
+            if (worker.aborted) {
+                return 0;
+            }
+
+            if (score > best_score) {
+                best_score = score;
+                best_move = move;
+
+                if (score > alpha) {
+                    alpha = score;
+
+                    // Extend the principal variation with the child's line
+                    worker.pv[ply][ply] = move;
+                    for (int i = ply + 1; i < worker.pv_length[ply + 1]; i++) {
+                        worker.pv[ply][i] = worker.pv[ply + 1][i];
+                    }
+                    worker.pv_length[ply] = worker.pv_length[ply + 1];
+
+                    if (alpha >= beta) {
+                        if (!capture && move != worker.killers[ply][0]) {
+                            worker.killers[ply][1] = worker.killers[ply][0];
+                            worker.killers[ply][0] = move;
+                        }
+                        break;
+                    }
+                }
+            }
+        }
+
+        // No legal move: mate if in check, otherwise stalemate
+        if (legal_moves == 0) {
+            return check ? -MATE_SCORE + ply : 0;
+        }
+
+        Bound bound = best_score >= beta ? BOUND_LOWER : (best_score > original_alpha ? BOUND_EXACT : BOUND_UPPER);
+        table.store(key, best_move, score_to_table(best_score, ply), depth, bound);
+        return best_score;
+    }
+
+    SearchResult Search::iterate(Worker& worker, int first_depth) {
+        SearchResult result;
+        const int max_depth = limits.depth > 0 ? std::min(limits.depth, MAX_PLY - 1) : MAX_PLY - 1;
+
+        for (int depth = first_depth; depth <= max_depth; depth++) {
+            worker.root_depth = depth;
+            int score = negamax(worker, depth, -INFINITE_SCORE, INFINITE_SCORE, 0);
+            if (worker.aborted || worker.pv_length[0] == 0) {
+                break;
+            }
+
+            result.best_move = worker.pv[0][0];
+            result.pv.assign(worker.pv[0], worker.pv[0] + worker.pv_length[0]);
+            result.score = score;
+            result.depth = depth;
+
+            // Only the main thread reports progress and applies the limits
+            if (worker.id != 0) {
+                continue;
+            }
+
+            result.nodes = total_nodes();
+            result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+            if (info_callback) {
+                info_callback(result);
+            }
+
+            // A mate within the searched depth cannot be improved on
+            if (is_mate_score(score) && MATE_SCORE - std::abs(score) <= depth) {
+                break;
+            }
+
+            // The next iteration takes longer than all previous ones together, so
+            // do not start it if more than half the time is already gone
+            if (limits.time_ms > 0 && result.seconds * 1000 * 2 > limits.time_ms) {
+                break;
+            }
+        }
+        return result;
+    }
+
+    SearchResult Search::run(const Game& game, const SearchLimits& search_limits) {
+        limits = search_limits;
+        start_time = std::chrono::steady_clock::now();
+        stop_requested = false;
+        helpers_stop = false;
+        table.new_search();
+
+        workers.clear();
+        for (int id = 0; id < thread_count; id++) {
+            std::unique_ptr<Worker> worker(new Worker());
+            worker->id = id;
+            worker->game = game;
+            worker->nodes = 0;
+            worker->aborted = false;
+            worker->root_depth = 0;
+            for (int ply = 0; ply < MAX_PLY; ply++) {
+                worker->killers[ply][0] = worker->killers[ply][1] = Move();
+                worker->pv_length[ply] = 0;
+            }
+            workers.push_back(std::move(worker));
+        }
+
+        SearchResult result;
+        MoveList legal = game.generate_legal_moves();
+        if (legal.empty()) {
+            result.score = game.in_check(game.turn_white()) ? -MATE_SCORE : 0;
+            result.thread_nodes.assign(thread_count, 0);
+            return result;
+        }
+
+        Move book_move;
+        if (book != nullptr && book->probe(game, legal, book_move)) {
+            result.best_move = book_move;
+            result.pv.push_back(book_move);
+            result.from_book = true;
+            result.thread_nodes.assign(thread_count, 0);
+            result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+            return result;
+        }
+
+        // Helpers start one or two plies deep so that threads spread over depths
+        std::vector<std::thread> helpers;
+        for (int id = 1; id < thread_count; id++) {
+            Worker* helper = workers[id].get();
+            helpers.push_back(std::thread([this, helper] { iterate(*helper, 1 + helper->id % 2); }));
+        }
+
+        SearchResult main_result = iterate(*workers[0], 1);
+
+        helpers_stop = true;
+        for (std::thread& helper : helpers) {
+            helper.join();
+        }
+
+        if (main_result.best_move == Move()) {
+            // Interrupted before the first iteration finished: play any legal move
+            result.best_move = legal[0];
+            result.pv.push_back(legal[0]);
+        } else {
+            result = main_result;
+        }
+
+        for (const std::unique_ptr<Worker>& worker : workers) {
+            result.thread_nodes.push_back(worker->nodes.load());
+        }
+        result.nodes = total_nodes();
+        result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+        return result;
+    }
+}
@@ -0,0 +1,193 @@
+#ifndef SEARCH_H
+#define SEARCH_H
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <thread>
+#include <vector>
+#include "Game.h"
+#include "Move.h"
+#include "OpeningBook.h"
+#include "Tablebase.h"
+#include "TranspositionTable.h"
+
+namespace Chess {
+    // Scores are in hundredths of a pawn from the point of view of the player to move.
+    // A score of MATE_SCORE - n means the player to move mates in n plies.
+    const int MATE_SCORE = 30000;
+    const int INFINITE_SCORE = 32000;
+
+    // Deepest ply the search will ever reach, including quiescence
+    const int MAX_PLY = 128;
+
+    // Longest mate a score can report: a tablebase mate in up to TB_LOSS - 1
+    // moves, found at the deepest ply of the search
+    const int MAX_MATE_PLIES = MAX_PLY + 2 * (TB_LOSS - 1);
+
+    // Returns true if the score reports a forced mate for either side
+    inline bool is_mate_score(int score) {
+        return score > MATE_SCORE - MAX_MATE_PLIES || score < -MATE_SCORE + MAX_MATE_PLIES;
+    }
+
+    // When to stop searching. A value of 0 means no limit of that kind; the search
+    // ends when the first limit is reached, and always completes at least depth 1.
+    struct SearchLimits {
+        int depth;
+        unsigned long long nodes;
+        int time_ms;
+
+        SearchLimits() : depth(0), nodes(0), time_ms(0) {}
+    };
+
+    // The outcome of a search, or of one completed iteration of it
+    struct SearchResult {
+        // The best move found, or the null Move if the player to move has none
+        Move best_move;
+
+        // Score of the best move
+        int score;
+
+        // Last fully searched depth
+        int depth;
+
+        // Positions visited, including quiescence, summed over all threads
+        unsigned long long nodes;
+
+        // Positions visited by each thread, the main thread first
+        std::vector<unsigned long long> thread_nodes;
+
+        // Time since the search started
+        double seconds;
+
+        // The expected line of play starting with best_move
+        std::vector<Move> pv;
+
+        // True if best_move was taken from the opening book without searching
+        bool from_book;
+
+        SearchResult() : score(0), depth(0), nodes(0), seconds(0), from_book(false) {}
+
+        // Nodes searched per second
+        unsigned long long nps() const {
+            return seconds > 0 ? static_cast<unsigned long long>(nodes / seconds) : 0;
+        }
+    };
+
+    // Finds a best move for the player to move with an iterative deepening negamax
+    // alpha-beta search. Each iteration is a full-width search to the current depth
+    // followed by a quiescence search of captures and promotions. Results are kept
+    // in a transposition table between iterations and between searches.
+    //
+    // The search plays moves on its own copy of the game with do_move/undo_move, so
+    // the game passed to run() is not modified.
+    //
+    // With more than one thread the search runs in Lazy SMP style: helper threads
+    // search the same position on their own copies of the game, starting at
+    // staggered depths, and share only the transposition table. The main thread
+    // decides when to stop and its result is returned. With one thread no helpers
+    // are started, so a search to a fixed depth is deterministic.
+    class Search {
+
+    public:
+        // Creates a search with a transposition table of the given size in megabytes
+        explicit Search(std::size_t hash_mb = 16);
+
+        // Sets the number of threads used by later searches, at least 1
+        void set_threads(int threads) { thread_count = threads > 1 ? threads : 1; }
+
+        // Returns the number of threads used by a search
+        int threads() const { return thread_count; }
+
+        // Searches the position until one of the limits is reached or stop() is called
+        SearchResult run(const Game& game, const SearchLimits& limits);
+
+        // Asks a running search to return as soon as possible. Safe to call from any thread.
+        void stop() { stop_requested = true; }
+
+        // Plays moves from the book, when it has one for the position, instead of
+        // searching. The book must stay open while it is set; nullptr turns it off.
+        void set_book(const OpeningBook* opening_book) { book = opening_book; }
+
+        // Scores positions found in the endgame tablebases exactly instead of
+        // searching below them. The tables must stay loaded while they are set;
+        // nullptr turns them off.
+        void set_tablebases(const Tablebases* tables) { tablebases = tables; }
+
+        // Called after each completed iteration with the result so far
+        void set_info_callback(std::function<void(const SearchResult&)> callback) { info_callback = callback; }
+
+        // Forgets everything learned in earlier searches
+        void clear() { table.clear(); }
+
+        // Returns the static evaluation of a position, from the point of view of the
+        // player to move. This is Game::evaluate().
+        static int evaluate(const Game& game);
+
+    private:
+        // Search state that changes as the tree is walked, one per thread
+        struct Worker {
+            // 0 for the main thread, which applies the limits and reports results
+            int id;
+
+            Game game;
+
+            // Only the owning thread writes this; others read it to sum the total
+            std::atomic<unsigned long long> nodes;
+
+            // Set when the current iteration was interrupted and its result must be discarded
+            bool aborted;
+
+            // Depth of the iteration in progress
+            int root_depth;
+
+            // Two quiet moves per ply that recently caused a cutoff
+            Move killers[MAX_PLY][2];
+
+            // Triangular principal variation table
+            Move pv[MAX_PLY][MAX_PLY];
+            int pv_length[MAX_PLY];
+        };
+
+        // Returns the score of the position to the given depth within (alpha, beta)
+        int negamax(Worker& worker, int depth, int alpha, int beta, int ply);
+
+        // Searches captures and promotions only, until the position is quiet
+        int quiescence(Worker& worker, int alpha, int beta, int ply);
+
+        // Orders moves so the most promising are searched first
+        void order_moves(const Worker& worker, MoveList& moves, const Move& hash_move, int ply) const;
+
+        // Runs iterative deepening on one worker and returns its last completed iteration
+        SearchResult iterate(Worker& worker, int first_depth);
+
+        // Returns true when a limit has been reached or stop() was called
+        bool should_stop(const Worker& worker);
+
+        // Counts one visited position for the worker and checks the limits every so often
+        void count_node(Worker& worker);
+
+        // Returns the number of positions visited by all workers so far
+        unsigned long long total_nodes() const;
+
+        // Converts mate scores between root-relative and node-relative form for the table
+        static int score_to_table(int score, int ply);
+        static int score_from_table(int score, int ply);
+
+        TranspositionTable table;
+        SearchLimits limits;
+        std::chrono::steady_clock::time_point start_time;
+        std::atomic<bool> stop_requested;
+
+        // Set by the main thread when it finishes, to stop the helpers
+        std::atomic<bool> helpers_stop;
+
+        int thread_count;
+        const OpeningBook* book;
+        const Tablebases* tablebases;
+        std::vector<std::unique_ptr<Worker> > workers;
+        std::function<void(const SearchResult&)> info_callback;
+    };
+}
+#endif // SEARCH_H
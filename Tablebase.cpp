@@ -0,0 +1,324 @@
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include "Tablebase.h"
+
+namespace Chess {
+    // Piece letters from strongest to weakest; names list pieces in this order
+    static const char PIECE_ORDER[] = "KQRBNP";
+
+    static PieceType type_of_letter(char letter) {
+        switch (letter) {
+            case 'Q': return QUEEN;
+            case 'R': return ROOK;
+            case 'B': return BISHOP;
+            case 'N': return KNIGHT;
+            case 'P': return PAWN;
+            default: return KING;
+        }
+    }
+
+    static char letter_of_type(PieceType type) {
+        switch (type) {
+            case QUEEN: return 'Q';
+            case ROOK: return 'R';
+            case BISHOP: return 'B';
+            case KNIGHT: return 'N';
+            case PAWN: return 'P';
+            case MYSTERY: return 'M';
+            default: return 'K';
+        }
+    }
+
+    static int strength_rank(char letter) {
+        const char* found = std::strchr(PIECE_ORDER, letter);
+        return found != nullptr ? static_cast<int>(found - PIECE_ORDER) : 6;
+    }
+
+    static bool stronger_first(char a, char b) {
+        return strength_rank(a) < strength_rank(b);
+    }
+
+    std::string material_name(const TablebasePosition& position) {
+        std::string white;
+        std::string black;
+        for (int i = 0; i < position.count; i++) {
+            (position.whites[i] ? white : black) += letter_of_type(position.types[i]);
+        }
+        std::sort(white.begin(), white.end(), stronger_first);
+        std::sort(black.begin(), black.end(), stronger_first);
+        return white + black;
+    }
+
+    std::string canonical_material(const std::string& material, bool& flipped) {
+        flipped = false;
+        std::string::size_type split = material.find('K', 1);
+        if (split == std::string::npos) {
+            return material;
+        }
+        std::string white = material.substr(0, split);
+        std::string black = material.substr(split);
+
+        // More pieces is stronger; otherwise compare the pieces strongest first
+        bool black_stronger = black.size() > white.size();
+        if (black.size() == white.size()) {
+            for (std::string::size_type i = 0; i < white.size(); i++) {
+                if (white[i] != black[i]) {
+                    black_stronger = stronger_first(black[i], white[i]);
+                    break;
+                }
+            }
+        }
+        if (black_stronger) {
+            flipped = true;
+            return black + white;
+        }
+        return material;
+    }
+
+    bool is_valid_material(const std::string& material) {
+        if (material.size() < 2 || static_cast<int>(material.size()) > TABLEBASE_MAX_PIECES || material[0] != 'K') {
+            return false;
+        }
+        std::string::size_type split = material.find('K', 1);
+        if (split == std::string::npos || material.find('K', split + 1) != std::string::npos) {
+            return false;
+        }
+        for (std::string::size_type i = 1; i < material.size(); i++) {
+            if (i == split) {
+                continue;
+            }
+            if (std::strchr("QRBNP", material[i]) == nullptr) {
+                return false;
+            }
+            // Each side lists its pieces strongest first, so every set has one name
+            if (i - 1 != split && stronger_first(material[i], material[i - 1])) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    TablebaseLayout::TablebaseLayout(const std::string& material) : name(material), count(0), pawns(false) {
+        std::string::size_type split = material.find('K', 1);
+
+        // Kings first, then white's pieces and black's pieces in name order
+        types[count] = KING;
+        whites[count++] = true;
+        types[count] = KING;
+        whites[count++] = false;
+        for (std::string::size_type i = 1; i < material.size(); i++) {
+            if (i == split) {
+                continue;
+            }
+            types[count] = type_of_letter(material[i]);
+            whites[count++] = i < split;
+            if (material[i] == 'P') {
+                pawns = true;
+            }
+        }
+
+        king_squares = pawns ? 32 : 16;
+        positions = 2 * king_squares;
+        for (int i = 1; i < count; i++) {
+            positions *= 64;
+        }
+    }
+
+    std::uint32_t TablebaseLayout::index(const TablebasePosition& position) const {
+        int squares[TABLEBASE_MAX_PIECES];
+        bool used[TABLEBASE_MAX_PIECES] = { false, false, false, false };
+
+        // Match the position's pieces to this table's slots
+        for (int slot = 0; slot < count; slot++) {
+            for (int i = 0; i < position.count; i++) {
+                if (!used[i] && position.types[i] == types[slot] && position.whites[i] == whites[slot]) {
+                    used[i] = true;
+                    squares[slot] = position.squares[i];
+                    break;
+                }
+            }
+        }
+
+        // Mirror so the white king is on columns A-D, and without pawns on rows 1-4
+        int flip = 0;
+        if (squares[0] % 8 >= 4) {
+            flip ^= 7;
+        }
+        if (!pawns && (squares[0] ^ flip) / 8 >= 4) {
+            flip ^= 56;
+        }
+        for (int slot = 0; slot < count; slot++) {
+            squares[slot] ^= flip;
+        }
+
+        // Identical pieces are stored in increasing square order
+        for (int slot = 2; slot + 1 < count; slot++) {
+            if (types[slot] == types[slot + 1] && whites[slot] == whites[slot + 1] && squares[slot] > squares[slot + 1]) {
+                std::swap(squares[slot], squares[slot + 1]);
+            }
+        }
+
+        std::uint32_t index = position.white_to_move ? 0 : 1;
+        index = index * king_squares + static_cast<std::uint32_t>((squares[0] / 8) * 4 + squares[0] % 8);
+        for (int slot = 1; slot < count; slot++) {
+            index = index * 64 + static_cast<std::uint32_t>(squares[slot]);
+        }
+        return index;
+    }
+
+    bool TablebaseLayout::decode(std::uint32_t index, TablebasePosition& position) const {
+        position.count = count;
+        for (int slot = count - 1; slot >= 1; slot--) {
+            position.squares[slot] = static_cast<int>(index % 64);
+            index /= 64;
+        }
+        std::uint32_t king = index % king_squares;
+        position.squares[0] = static_cast<int>((king / 4) * 8 + king % 4);
+        position.white_to_move = index / king_squares == 0;
+
+        Bitboard occupied = 0;
+        for (int slot = 0; slot < count; slot++) {
+            position.types[slot] = types[slot];
+            position.whites[slot] = whites[slot];
+            int square = position.squares[slot];
+            if (occupied & square_bb(square)) {
+                return false;
+            }
+            occupied |= square_bb(square);
+            if (types[slot] == PAWN && (square / 8 == 0 || square / 8 == 7)) {
+                return false;
+            }
+            if (slot >= 3 && types[slot] == types[slot - 1] && whites[slot] == whites[slot - 1]
+                && square < position.squares[slot - 1]) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    TablebaseResult decode_tablebase_value(std::uint8_t value) {
+        TablebaseResult result;
+        if (value == TB_DRAW || value == TB_INVALID) {
+            return result;
+        }
+        if (value < TB_LOSS) {
+            result.outcome = 1;
+            result.plies = 2 * value - 1;
+        } else {
+            result.outcome = -1;
+            result.plies = 2 * (value - TB_LOSS);
+        }
+        return result;
+    }
+
+    Tablebases::Tablebases() : largest(0) {}
+
+    int Tablebases::load_directory(const std::string& directory) {
+        int added = 0;
+        std::error_code error;
+        for (std::filesystem::directory_iterator it(directory, error), end; !error && it != end; it.increment(error)) {
+            if (it->path().extension() == ".ctb" && load_file(it->path().string())) {
+                added++;
+            }
+        }
+        return added;
+    }
+
+    bool Tablebases::load_file(const std::string& path) {
+        std::unique_ptr<MappedFile> file(new MappedFile(path.c_str()));
+        if (!file->is_open() || file->size() < TABLEBASE_HEADER_SIZE) {
+            return false;
+        }
+        const char* data = file->contents().data();
+        if (std::memcmp(data, "CHTB", 4) != 0) {
+            return false;
+        }
+
+        std::string material(data + 4, 8);
+        material.resize(std::strlen(material.c_str()));
+        bool flipped = false;
+        if (!is_valid_material(material) || canonical_material(material, flipped) != material) {
+            return false;
+        }
+
+        std::unique_ptr<TablebaseLayout> layout(new TablebaseLayout(material));
+        const unsigned char* header = reinterpret_cast<const unsigned char*>(data);
+        std::uint32_t positions = static_cast<std::uint32_t>(header[12]) | static_cast<std::uint32_t>(header[13]) << 8
+                                  | static_cast<std::uint32_t>(header[14]) << 16 | static_cast<std::uint32_t>(header[15]) << 24;
+        if (positions != layout->size() || file->size() != TABLEBASE_HEADER_SIZE + positions) {
+            return false;
+        }
+
+        Table& table = tables[material];
+        table.values = reinterpret_cast<const std::uint8_t*>(data + TABLEBASE_HEADER_SIZE);
+        table.layout = std::move(layout);
+        table.file = std::move(file);
+        largest = std::max(largest, table.layout->piece_count());
+        return true;
+    }
+
+    void Tablebases::add(const std::string& material, const std::uint8_t* values) {
+        Table& table = tables[material];
+        table.layout.reset(new TablebaseLayout(material));
+        table.file.reset();
+        table.values = values;
+        largest = std::max(largest, table.layout->piece_count());
+    }
+
+    bool Tablebases::has(const std::string& material) const {
+        return tables.find(material) != tables.end();
+    }
+
+    std::uint8_t Tablebases::value(const TablebasePosition& position) const {
+        if (position.count < 2 || position.count > largest) {
+            return TB_INVALID;
+        }
+        bool flipped = false;
+        std::map<std::string, Table>::const_iterator it = tables.find(canonical_material(material_name(position), flipped));
+        if (it == tables.end()) {
+            return TB_INVALID;
+        }
+        if (!flipped) {
+            return it->second.values[it->second.layout->index(position)];
+        }
+
+        // Black holds the stronger pieces: swap the colors and turn the board around
+        TablebasePosition mirrored = position;
+        mirrored.white_to_move = !position.white_to_move;
+        for (int i = 0; i < position.count; i++) {
+            mirrored.whites[i] = !position.whites[i];
+            mirrored.squares[i] = position.squares[i] ^ 56;
+        }
+        return it->second.values[it->second.layout->index(mirrored)];
+    }
+
+    bool Tablebases::probe(const TablebasePosition& position, TablebaseResult& result) const {
+        std::uint8_t stored = value(position);
+        if (stored == TB_INVALID) {
+            return false;
+        }
+        result = decode_tablebase_value(stored);
+        return true;
+    }
+
+    bool Tablebases::probe(const Game& game, TablebaseResult& result) const {
+        Bitboard occupied = game.occupancy();
+        if (pop_count(occupied) > largest) {
+            return false;
+        }
+
+        TablebasePosition position;
+        position.white_to_move = game.turn_white();
+        while (occupied) {
+            int square = pop_lsb(occupied);
+            const Piece* piece = game.piece_at(position_of(square));
+            PieceType type = piece_type(piece_index(piece->to_ascii()));
+            if (type == MYSTERY) {
+                return false;
+            }
+            position.add(type, piece->is_white(), square);
+        }
+        return probe(position, result);
+    }
+}
@@ -0,0 +1,176 @@
+#ifndef TABLEBASE_H
+#define TABLEBASE_H
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+#include "Bitboard.h"
+#include "Game.h"
+#include "MappedFile.h"
+
+namespace Chess {
+    // Endgame tablebases: for every position with a given set of pieces, whether
+    // the player to move wins, loses or draws with best play, and in how many
+    // moves. The tables are built by the tbgen tool and follow this game's rules,
+    // so pawns always promote to a queen and there is no en passant.
+    //
+    // A material set is named by the white pieces and then the black ones, each
+    // starting with the king and in the order QRBNP, e.g. "KQK" or "KBNK" or
+    // "KQKR". Only the stronger side is stored; positions where black has the
+    // stronger pieces are looked up with the colors swapped and the board flipped.
+    //
+    // A table stores one byte per position. Positions are indexed by the squares
+    // of the pieces in material order, white king first, after mirroring the
+    // board so that the white king is on columns A-D and, without pawns, also on
+    // rows 1-4. Byte values are:
+    //   0         draw
+    //   1..127    the player to move mates in that many moves
+    //   128..254  the player to move is mated in (value - 128) moves
+    //   255       not a legal position
+    //
+    // Files are named "<material>.ctb" and start with a 16-byte header: the four
+    // characters "CHTB", the material name padded with zero bytes to 8 characters,
+    // and the number of positions as a little-endian 32-bit number.
+
+    // Most pieces, kings included, that a table may hold
+    const int TABLEBASE_MAX_PIECES = 4;
+
+    // Byte values stored in a table
+    const std::uint8_t TB_DRAW = 0;
+    const std::uint8_t TB_LOSS = 128;
+    const std::uint8_t TB_INVALID = 255;
+
+    // Size of the file header
+    const std::size_t TABLEBASE_HEADER_SIZE = 16;
+
+    // A position reduced to what the tablebases need
+    struct TablebasePosition {
+        int count;
+        PieceType types[TABLEBASE_MAX_PIECES];
+        bool whites[TABLEBASE_MAX_PIECES];
+        int squares[TABLEBASE_MAX_PIECES];
+        bool white_to_move;
+
+        TablebasePosition() : count(0), white_to_move(true) {}
+
+        void add(PieceType type, bool white, int square) {
+            types[count] = type;
+            whites[count] = white;
+            squares[count] = square;
+            count++;
+        }
+    };
+
+    // The outcome of a lookup, for the player to move
+    struct TablebaseResult {
+        // 1 for a win, 0 for a draw and -1 for a loss
+        int outcome;
+
+        // Moves by both players until mate, 0 for a draw
+        int plies;
+
+        TablebaseResult() : outcome(0), plies(0) {}
+    };
+
+    // Returns the material name of a position as seen from its own colors, e.g.
+    // "KKQ" when black has a queen against a bare king
+    std::string material_name(const TablebasePosition& position);
+
+    // Returns the name under which the material is stored, and sets flipped if the
+    // colors have to be swapped to look it up
+    std::string canonical_material(const std::string& material, bool& flipped);
+
+    // Returns true if the name is a set of pieces the tablebases can hold
+    bool is_valid_material(const std::string& material);
+
+    // The order of the pieces in one table and how positions map to indices
+    class TablebaseLayout {
+
+    public:
+        // The material must be valid and canonical
+        explicit TablebaseLayout(const std::string& material);
+
+        const std::string& material() const { return name; }
+
+        // Number of positions, for both players to move
+        std::uint32_t size() const { return positions; }
+
+        // Number of pieces, kings included
+        int piece_count() const { return count; }
+
+        bool has_pawns() const { return pawns; }
+
+        // Returns the index of a position that has exactly this table's pieces,
+        // with white holding the pieces named first
+        std::uint32_t index(const TablebasePosition& position) const;
+
+        // Fills in the position with the given index, in its mirrored form. Returns
+        // false if two pieces share a square or a pawn is on the first or last row.
+        bool decode(std::uint32_t index, TablebasePosition& position) const;
+
+    private:
+        std::string name;
+        int count;
+        bool pawns;
+
+        // Squares the white king can be on after mirroring: 16 or 32
+        std::uint32_t king_squares;
+        std::uint32_t positions;
+        PieceType types[TABLEBASE_MAX_PIECES];
+        bool whites[TABLEBASE_MAX_PIECES];
+    };
+
+    // A set of tables, either memory-mapped from files or held by the caller
+    class Tablebases {
+
+    public:
+        Tablebases();
+
+        Tablebases(const Tablebases&) = delete;
+        Tablebases& operator=(const Tablebases&) = delete;
+
+        // Maps every .ctb file in the directory. Returns the number of tables added.
+        int load_directory(const std::string& directory);
+
+        // Maps one table file. Returns false if it cannot be read or is not a table.
+        bool load_file(const std::string& path);
+
+        // Adds a table held in memory, which must outlive this object
+        void add(const std::string& material, const std::uint8_t* values);
+
+        // Returns true if the material (in canonical form) is available
+        bool has(const std::string& material) const;
+
+        // Number of tables
+        int size() const { return static_cast<int>(tables.size()); }
+
+        // Most pieces of any available table, or 0 if there are none
+        int max_pieces() const { return largest; }
+
+        // Returns the stored byte for a position, or TB_INVALID if no table holds it
+        std::uint8_t value(const TablebasePosition& position) const;
+
+        // Looks up the position. Returns false if no table holds it.
+        bool probe(const TablebasePosition& position, TablebaseResult& result) const;
+
+        // Looks up a game position. Returns false if it has mystery pieces or
+        // too many pieces, or if no table holds it.
+        bool probe(const Game& game, TablebaseResult& result) const;
+
+    private:
+        struct Table {
+            std::unique_ptr<TablebaseLayout> layout;
+            std::unique_ptr<MappedFile> file;
+            const std::uint8_t* values;
+        };
+
+        std::map<std::string, Table> tables;
+        int largest;
+    };
+
+    // Converts a stored byte into a result for the player to move
+    TablebaseResult decode_tablebase_value(std::uint8_t value);
+}
+#endif // TABLEBASE_H
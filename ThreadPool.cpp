@@ -0,0 +1,112 @@
+#include "ThreadPool.h"
+
+namespace Chess {
+    // Identifies the pool and index of the worker running on the current thread
+    static thread_local const ThreadPool* current_pool = nullptr;
+    static thread_local int current_index = -1;
+
+    ThreadPool::ThreadPool(int threads) : queued(0), pending(0), stopping(false), next_queue(0) {
+        if (threads <= 0) {
+            threads = static_cast<int>(std::thread::hardware_concurrency());
+            if (threads <= 0) {
+                threads = 1;
+            }
+        }
+
+        for (int i = 0; i < threads; i++) {
+            queues.push_back(std::unique_ptr<Queue>(new Queue()));
+        }
+        for (int i = 0; i < threads; i++) {
+            workers.push_back(std::thread(&ThreadPool::run, this, i));
+        }
+    }
+
+    ThreadPool::~ThreadPool() {
+        wait();
+        {
+            std::lock_guard<std::mutex> lock(state_mutex);
+            stopping = true;
+        }
+        work_available.notify_all();
+        for (std::thread& worker : workers) {
+            worker.join();
+        }
+    }
+
+    int ThreadPool::worker_index() const {
+        return current_pool == this ? current_index : -1;
+    }
+
+    void ThreadPool::submit(Task task) {
+        int index = worker_index();
+        if (index < 0) {
+            index = static_cast<int>(next_queue++ % queues.size());
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(state_mutex);
+            pending++;
+        }
+        {
+            std::lock_guard<std::mutex> lock(queues[index]->mutex);
+            queues[index]->tasks.push_back(std::move(task));
+        }
+        {
+            std::lock_guard<std::mutex> lock(state_mutex);
+            queued++;
+        }
+        work_available.notify_one();
+    }
+
+    void ThreadPool::wait() {
+        std::unique_lock<std::mutex> lock(state_mutex);
+        all_done.wait(lock, [this] { return pending == 0; });
+    }
+
+    bool ThreadPool::take(int index, Task& task) {
+        const int count = static_cast<int>(queues.size());
+        for (int i = 0; i < count; i++) {
+            Queue& queue = *queues[(index + i) % count];
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            if (queue.tasks.empty()) {
+                continue;
+            }
+
+            // Newest first from our own queue, oldest first when stealing
+            if (i == 0) {
+                task = std::move(queue.tasks.back());
+                queue.tasks.pop_back();
+            } else {
+                task = std::move(queue.tasks.front());
+                queue.tasks.pop_front();
+            }
+            queued--;
+            return true;
+        }
+        return false;
+    }
+
+    void ThreadPool::run(int index) {
+        current_pool = this;
+        current_index = index;
+
+        while (true) {
+            Task task;
+            if (take(index, task)) {
+                task();
+
+                std::lock_guard<std::mutex> lock(state_mutex);
+                if (--pending == 0) {
+                    all_done.notify_all();
+                }
+                continue;
+            }
+
+            std::unique_lock<std::mutex> lock(state_mutex);
+            work_available.wait(lock, [this] { return stopping || queued > 0; });
+            if (stopping && queued == 0) {
+                return;
+            }
+        }
+    }
+}
@@ -0,0 +1,69 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Chess {
+    // A fixed set of worker threads with one task queue each. A worker takes new
+    // tasks from the back of its own queue and, when that is empty, steals from
+    // the front of the other queues, so uneven tasks still keep every thread busy.
+    class ThreadPool {
+
+    public:
+        typedef std::function<void()> Task;
+
+        // Starts the given number of workers, or one per hardware thread if it is 0
+        explicit ThreadPool(int threads = 0);
+
+        // Waits for queued tasks to finish, then stops the workers
+        ~ThreadPool();
+
+        ThreadPool(const ThreadPool&) = delete;
+        ThreadPool& operator=(const ThreadPool&) = delete;
+
+        // Queues a task. Tasks submitted from a worker go to that worker's own
+        // queue; others are spread over the queues in turn.
+        void submit(Task task);
+
+        // Blocks until every submitted task has finished
+        void wait();
+
+        // Returns the number of workers
+        int size() const { return static_cast<int>(workers.size()); }
+
+        // Returns the index of the calling worker in [0, size()), or -1 if the
+        // caller is not one of this pool's workers
+        int worker_index() const;
+
+    private:
+        struct Queue {
+            std::mutex mutex;
+            std::deque<Task> tasks;
+        };
+
+        void run(int index);
+
+        // Takes a task from the worker's own queue or steals one from another
+        bool take(int index, Task& task);
+
+        std::vector<std::thread> workers;
+        std::vector<std::unique_ptr<Queue> > queues;
+
+        // Guards sleeping and waking; pending counts queued plus running tasks
+        std::mutex state_mutex;
+        std::condition_variable work_available;
+        std::condition_variable all_done;
+        std::atomic<int> queued;
+        int pending;
+        bool stopping;
+        std::atomic<unsigned> next_queue;
+    };
+}
+#endif // THREAD_POOL_H
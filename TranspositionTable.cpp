@@ -0,0 +1,118 @@
+#include <algorithm>
+#include "TranspositionTable.h"
+
+namespace Chess {
+    TranspositionTable::TranspositionTable(std::size_t megabytes) : bucket_count(0), generation(0) {
+        resize(megabytes);
+    }
+
+    void TranspositionTable::resize(std::size_t megabytes) {
+        // Round down to a power of two so a key can be mapped to a bucket with a mask
+        std::size_t wanted = std::max<std::size_t>(megabytes, 1) * 1024 * 1024 / sizeof(Bucket);
+        std::size_t count = 1;
+        while (count * 2 <= wanted) {
+            count *= 2;
+        }
+
+        buckets.reset(new Bucket[count]);
+        bucket_count = count;
+        clear();
+    }
+
+    void TranspositionTable::clear() {
+        for (std::size_t i = 0; i < bucket_count; i++) {
+            for (int j = 0; j < BUCKET_SIZE; j++) {
+                buckets[i].slots[j].check.store(0, std::memory_order_relaxed);
+                buckets[i].slots[j].data.store(0, std::memory_order_relaxed);
+            }
+        }
+        generation = 0;
+    }
+
+    std::uint64_t TranspositionTable::pack(const Move& move, int score, int depth, Bound bound, unsigned gen) {
+        return static_cast<std::uint64_t>(move.raw())
+             | static_cast<std::uint64_t>(static_cast<std::uint16_t>(score)) << 16
+             | static_cast<std::uint64_t>(static_cast<std::uint8_t>(depth)) << 32
+             | static_cast<std::uint64_t>(bound) << 40
+             | static_cast<std::uint64_t>(gen & GENERATION_MASK) << 42;
+    }
+
+    bool TranspositionTable::probe(HashKey key, TTEntry& entry) const {
+        const Bucket& bucket = bucket_for(key);
+        for (int i = 0; i < BUCKET_SIZE; i++) {
+            std::uint64_t data = bucket.slots[i].data.load(std::memory_order_relaxed);
+            std::uint64_t check = bucket.slots[i].check.load(std::memory_order_relaxed);
+            if ((check ^ data) != key || data == 0) {
+                continue;
+            }
+
+            entry.move = Move::from_raw(static_cast<std::uint16_t>(data));
+            entry.score = static_cast<std::int16_t>(data >> 16);
+            entry.depth = static_cast<std::int8_t>(data >> 32);
+            entry.bound = static_cast<Bound>((data >> 40) & 3);
+            return entry.bound != BOUND_NONE;
+        }
+        return false;
+    }
+
+    void TranspositionTable::store(HashKey key, const Move& move, int score, int depth, Bound bound) {
+        Bucket& bucket = bucket_for(key);
+        Slot* replace = &bucket.slots[0];
+        int worst = 1 << 30;
+
+        for (int i = 0; i < BUCKET_SIZE; i++) {
+            Slot& slot = bucket.slots[i];
+            std::uint64_t data = slot.data.load(std::memory_order_relaxed);
+            std::uint64_t check = slot.check.load(std::memory_order_relaxed);
+
+            // Same position: keep the old best move if the new result has none,
+            // and do not let a much shallower non-exact result replace a deep one
+            if ((check ^ data) == key && data != 0) {
+                int old_depth = static_cast<std::int8_t>(data >> 32);
+                if (bound != BOUND_EXACT && depth + 2 < old_depth
+                    && ((data >> 42) & GENERATION_MASK) == generation) {
+                    return;
+                }
+                Move best = move;
+                if (best == Move()) {
+                    best = Move::from_raw(static_cast<std::uint16_t>(data));
+                }
+                std::uint64_t packed = pack(best, score, depth, bound, generation);
+                slot.data.store(packed, std::memory_order_relaxed);
+                slot.check.store(key ^ packed, std::memory_order_relaxed);
+                return;
+            }
+
+            // Otherwise prefer empty slots, then old ones, then shallow ones
+            int value;
+            if (data == 0) {
+                value = -(1 << 20);
+            } else {
+                int age = (generation - static_cast<unsigned>((data >> 42) & GENERATION_MASK)) & GENERATION_MASK;
+                value = static_cast<std::int8_t>(data >> 32) - 8 * age;
+            }
+            if (value < worst) {
+                worst = value;
+                replace = &slot;
+            }
+        }
+
+        std::uint64_t packed = pack(move, score, depth, bound, generation);
+        replace->data.store(packed, std::memory_order_relaxed);
+        replace->check.store(key ^ packed, std::memory_order_relaxed);
+    }
+
+    int TranspositionTable::hashfull() const {
+        std::size_t sample = std::min<std::size_t>(bucket_count, 250);
+        int used = 0;
+        for (std::size_t i = 0; i < sample; i++) {
+            for (int j = 0; j < BUCKET_SIZE; j++) {
+                std::uint64_t data = buckets[i].slots[j].data.load(std::memory_order_relaxed);
+                if (data != 0 && ((data >> 42) & GENERATION_MASK) == generation) {
+                    used++;
+                }
+            }
+        }
+        return static_cast<int>(used * 1000 / (sample * BUCKET_SIZE));
+    }
+}
@@ -0,0 +1,92 @@
+#ifndef TRANSPOSITION_TABLE_H
+#define TRANSPOSITION_TABLE_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include "Move.h"
+#include "Zobrist.h"
+
+namespace Chess {
+    // How a stored score relates to the true score of the position
+    enum Bound {
+        BOUND_NONE = 0,
+        BOUND_UPPER,    // the true score is at most the stored score
+        BOUND_LOWER,    // the true score is at least the stored score
+        BOUND_EXACT
+    };
+
+    // What a search found out about a position, as read back from the table
+    struct TTEntry {
+        Move move;
+        int score;
+        int depth;
+        Bound bound;
+    };
+
+    // A fixed-size hash table of search results shared by any number of threads.
+    //
+    // Each slot is two 64-bit atomics: the packed data, and the position key XORed
+    // with that data. Readers and writers never lock. If two threads write the same
+    // slot at once, the key check fails for the torn pair and the probe is a miss.
+    //
+    // Slots are grouped four to a bucket. A store overwrites the slot for the same
+    // position if there is one; otherwise it replaces the slot whose result is the
+    // shallowest once age is taken into account, so results from earlier searches
+    // give way to new ones.
+    class TranspositionTable {
+
+    public:
+        // Creates a table using about the given number of megabytes
+        explicit TranspositionTable(std::size_t megabytes = 16);
+
+        // Reallocates the table with about the given number of megabytes and clears it.
+        // Must not be called while other threads are using the table.
+        void resize(std::size_t megabytes);
+
+        // Removes every entry. Must not be called while other threads are using the table.
+        void clear();
+
+        // Marks the start of a new search, so older entries are replaced first
+        void new_search() { generation = (generation + 1) & GENERATION_MASK; }
+
+        // Looks up a position. Returns true and fills entry if it was found.
+        bool probe(HashKey key, TTEntry& entry) const;
+
+        // Records the result of searching a position to the given depth
+        void store(HashKey key, const Move& move, int score, int depth, Bound bound);
+
+        // Returns how full the table is, in permille of a sample of buckets
+        int hashfull() const;
+
+        // Returns the size of the table in bytes
+        std::size_t size_bytes() const { return bucket_count * sizeof(Bucket); }
+
+    private:
+        static const int BUCKET_SIZE = 4;
+        static const unsigned GENERATION_MASK = 0x3F;
+
+        struct Slot {
+            std::atomic<std::uint64_t> check;
+            std::atomic<std::uint64_t> data;
+        };
+
+        // Four slots of 16 bytes, so a bucket fills one 64-byte cache line. The
+        // alignment makes new[] (aligned new, since C++17) start every bucket on
+        // a line boundary, so none straddles two lines.
+        struct alignas(64) Bucket {
+            Slot slots[BUCKET_SIZE];
+        };
+
+        // Packs a result into 64 bits: move (16), score (16), depth (8), bound (2), generation (6)
+        static std::uint64_t pack(const Move& move, int score, int depth, Bound bound, unsigned gen);
+
+        Bucket& bucket_for(HashKey key) const { return buckets[key & (bucket_count - 1)]; }
+
+        std::unique_ptr<Bucket[]> buckets;
+        std::size_t bucket_count;
+        unsigned generation;
+    };
+}
+#endif // TRANSPOSITION_TABLE_H
@@ -0,0 +1,26 @@
+#include "Zobrist.h"
+
+namespace Chess {
+    // SplitMix64, a small generator whose output is well distributed for any seed
+    static HashKey next_random(HashKey& state) {
+        HashKey z = (state += 0x9E3779B97F4A7C15ULL);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        return z ^ (z >> 31);
+    }
+
+    ZobristKeys::ZobristKeys() {
+        HashKey state = 0x43686573734B6579ULL;
+        for (int index = 0; index < PIECE_TYPES; index++) {
+            for (int sq = 0; sq < 64; sq++) {
+                pieces[index][sq] = next_random(state);
+            }
+        }
+        black_to_move = next_random(state);
+    }
+
+    const ZobristKeys& zobrist_keys() {
+        static const ZobristKeys keys;
+        return keys;
+    }
+}
@@ -0,0 +1,27 @@
+#ifndef ZOBRIST_H
+#define ZOBRIST_H
+
+#include <cstdint>
+#include "Bitboard.h"
+
+namespace Chess {
+    // A 64-bit position key. Two positions with the same pieces on the same
+    // squares and the same player to move always have the same key.
+    typedef std::uint64_t HashKey;
+
+    // The random numbers that are XORed together to form a position key
+    struct ZobristKeys {
+        // One number per piece designator and square
+        HashKey pieces[PIECE_TYPES][64];
+
+        // Included in the key when it is black's turn
+        HashKey black_to_move;
+
+        ZobristKeys();
+    };
+
+    // Returns the keys, which are generated from a fixed seed the first time this is
+    // called, so keys are the same in every run of the program
+    const ZobristKeys& zobrist_keys();
+}
+#endif // ZOBRIST_H
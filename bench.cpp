@@ -0,0 +1,100 @@
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "Game.h"
+#include "Search.h"
+
+// Searches a fixed set of positions to a fixed depth, first with one thread and
+// then with the requested number of threads, and reports the nodes searched by
+// each thread and the speedup of the multi-threaded search.
+
+// Positions in the save file format read by operator>>
+static const char* const POSITIONS[] = {
+	"rnbqkbnr\npppppppp\n--------\n--------\n--------\n--------\nPPPPPPPP\nRNBQKBNR\nw",
+	"r---k--r\np-ppqpb-\nbn--pnp-\n---PN---\n-p--P---\n--N--Q-p\nPPPBBPPP\nR---K--R\nw",
+	"--------\n--p-----\n---p----\nKP-----r\n-R---p-k\n--------\n----P-P-\n--------\nw",
+	"r---k--r\nPppp-ppp\n-b---nbN\nnP------\nBBP-P---\nq----N--\nPp-P--PP\nR--Q-RK-\nw",
+	"r-bq-rk-\npp---ppp\n--n-pn--\n--bp----\n--B-P---\n--N--N--\nPPP--PPP\nR-BQ-RK-\nw",
+};
+
+static const int POSITION_COUNT = sizeof(POSITIONS) / sizeof(POSITIONS[0]);
+
+void show_usage() {
+	std::cout << "Usage:" << std::endl;
+	std::cout << "\tbench [<depth>] [--threads <n>] [--hash <mb>]" << std::endl;
+	std::cout << "\t                search each bundled position to <depth> (default 6) with one" << std::endl;
+	std::cout << "\t                thread, then with <n> threads (default one per core)" << std::endl;
+}
+
+Chess::SearchResult search_position(int index, int depth, int threads, std::size_t hash_mb) {
+	Chess::Game game;
+	std::istringstream iss(POSITIONS[index]);
+	iss >> game;
+
+	// A fresh table for every run, so runs do not help each other
+	Chess::Search search(hash_mb);
+	search.set_threads(threads);
+	Chess::SearchLimits limits;
+	limits.depth = depth;
+	return search.run(game, limits);
+}
+
+int main(int argc, char* argv[]) {
+	int depth = 6;
+	int threads = static_cast<int>(std::thread::hardware_concurrency());
+	std::size_t hash_mb = 16;
+
+	for (int i = 1; i < argc; i++) {
+		std::string arg = argv[i];
+		if (arg == "--threads" && i + 1 < argc) {
+			threads = std::atoi(argv[++i]);
+		} else if (arg == "--hash" && i + 1 < argc) {
+			hash_mb = static_cast<std::size_t>(std::atoi(argv[++i]));
+		} else if (arg[0] != '-' && std::atoi(arg.c_str()) > 0) {
+			depth = std::atoi(arg.c_str());
+		} else {
+			show_usage();
+			return 1;
+		}
+	}
+	if (threads < 1) {
+		threads = 1;
+	}
+
+	double serial_seconds = 0;
+	double parallel_seconds = 0;
+	unsigned long long serial_nodes = 0;
+	unsigned long long parallel_nodes = 0;
+
+	for (int i = 0; i < POSITION_COUNT; i++) {
+		Chess::SearchResult serial = search_position(i, depth, 1, hash_mb);
+		Chess::SearchResult parallel = search_position(i, depth, threads, hash_mb);
+
+		serial_seconds += serial.seconds;
+		parallel_seconds += parallel.seconds;
+		serial_nodes += serial.nodes;
+		parallel_nodes += parallel.nodes;
+
+		std::cout << "Position " << i + 1 << ": 1 thread " << serial.best_move.name() << " score " << serial.score
+		          << ", " << serial.nodes << " nodes, " << static_cast<long long>(serial.seconds * 1000) << " ms; "
+		          << threads << " threads " << parallel.best_move.name() << " score " << parallel.score
+		          << ", " << static_cast<long long>(parallel.seconds * 1000) << " ms" << std::endl;
+		std::cout << "\tnodes per thread:";
+		for (unsigned long long nodes : parallel.thread_nodes) {
+			std::cout << " " << nodes;
+		}
+		std::cout << std::endl;
+	}
+
+	std::cout << std::endl;
+	std::cout << "Depth: " << depth << std::endl;
+	std::cout << "1 thread: " << serial_nodes << " nodes, " << static_cast<long long>(serial_seconds * 1000) << " ms, "
+	          << static_cast<long long>(serial_seconds > 0 ? serial_nodes / serial_seconds : 0) << " nodes/sec" << std::endl;
+	std::cout << threads << " threads: " << parallel_nodes << " nodes, " << static_cast<long long>(parallel_seconds * 1000) << " ms, "
+	          << static_cast<long long>(parallel_seconds > 0 ? parallel_nodes / parallel_seconds : 0) << " nodes/sec" << std::endl;
+	std::cout << "Speedup: " << (parallel_seconds > 0 ? serial_seconds / parallel_seconds : 0) << std::endl;
+	return 0;
+}
@@ -1,26 +1,72 @@
 #include <fstream>
 #include <iostream>
+#include <iterator>
+#include <sstream>
 #include <string>
+#include <string_view>
 #include <cassert>
 #include "Game.h"
+#include "Search.h"
 
 void show_commands() {
 	std::cout << "List of commands:" << std::endl;
 	std::cout << "\t'?':            show this list of options" << std::endl;
 	std::cout << "\t'Q':            quit the game" << std::endl;
 	std::cout << "\t'L' <filename>: load a game from the specified file" << std::endl;
-	std::cout << "\t                <filename> is the name of the file to read from" <<std::endl;
+	std::cout << "\t                <filename> is the name of the file to read from," <<std::endl;
+	std::cout << "\t                holding either a saved game or a FEN record" <<std::endl;
 	std::cout << "\t'S' <filename>: save a game to the specified file" << std::endl;
-	std::cout << "\t                <filename> is the name of the file to write to" <<std::endl;
+	std::cout << "\t                <filename> is the name of the file to write to;" <<std::endl;
+	std::cout << "\t                names ending in .fen are written as a FEN record" <<std::endl;
 	std::cout << "\t'M' <move>:     try to make the specified move" << std::endl;
 	std::cout << "\t                <move> is a four character string giving the" << std::endl;
 	std::cout << "\t                column (['A'-'H']), row ('1'-'8') of the start position" << std::endl;
 	std::cout << "\t                followed by the column and row of the end position" << std::endl;
+	std::cout << "\t'C':            let the computer make the next move" << std::endl;
+	std::cout << "\t'B' <book>:     use a Polyglot (.bin) opening book for computer moves" << std::endl;
+	std::cout << "\t'T' <directory>: use the endgame tablebases built by tbgen in the directory" << std::endl;
+}
+
+// Loads a game from a file holding either the save format or a FEN record
+void load_game(const std::string& filename, Chess::Game& game) {
+	std::ifstream ifs(filename);
+	std::string contents((std::istreambuf_iterator<char>(ifs)), std::istreambuf_iterator<char>());
+
+	// FEN separates the rows with '/', which the save format never uses
+	if (contents.find('/') != std::string::npos) {
+		std::string_view record(contents);
+		game.load_fen(record.substr(0, record.find('\n')));
+	} else {
+		std::istringstream iss(contents);
+		iss >> game;
+	}
+}
+
+// Saves a game to a file, as a FEN record if the file name ends in ".fen"
+void save_game(const std::string& filename, const Chess::Game& game) {
+	const std::string extension = ".fen";
+	std::ofstream ofs(filename);
+	if (filename.size() >= extension.size()
+	    && filename.compare(filename.size() - extension.size(), extension.size(), extension) == 0) {
+		ofs << game.to_fen() << std::endl;
+	} else {
+		ofs << game;
+	}
 }
 
 int main(int argc, char* argv[]) {
 	Chess::Game game;
 
+	// The computer opponent, which thinks for a fixed time per move
+	Chess::Search engine;
+	const int computer_time_ms = 2000;
+
+	// Opening book consulted by the computer before it searches
+	Chess::OpeningBook book;
+
+	// Endgame tables the computer's search looks positions up in
+	Chess::Tablebases tablebases;
+
 	// Display command options
 	show_commands();
 
@@ -39,23 +85,24 @@ int main(int argc, char* argv[]) {
 			std::cout << "black move" << std::endl;
 		}
 
-        // Indicate current player's material point value
-        std::cout << "Material point value: " << game.point_value(game.turn_white()) << std::endl;
+		// Legal moves, check, mate and material, worked out once for this position
+		const Chess::GameStatus& status = game.status();
 
-		bool is_turn_white = game.turn_white();
+        // Indicate current player's material point value
+        std::cout << "Material point value: " << status.material << std::endl;
 
 		// If the board is in a check-mate state, end the game
-		if (game.in_mate(is_turn_white)) {
+		if (status.mate) {
 			std::cout << "Checkmate! Game over." << std::endl;
 			game_over = true;
 			break;
 
 		// If the board is in a check state, notify the players
-        	} else if (game.in_check(is_turn_white)) {
+        	} else if (status.check) {
         		std::cout << "You are in check!" << std::endl;
 
 		// If the board is in a stalemate state, notify the players
-		} else if (game.in_stalemate(is_turn_white)) {
+		} else if (status.stalemate) {
 			std::cout << "Stalemate! Game over." << std::endl;
 			game_over = true;
 			break;
@@ -87,10 +134,7 @@ int main(int argc, char* argv[]) {
 				try {
 				    std::string argument;
 				    std::cin >> argument;
-				    std::ifstream ifs;
-				    ifs.open( argument );
-				    ifs >> game;
-				    ifs.close();
+				    load_game(argument, game);
 				    // Check that the game is valid
 				    assert(game.is_valid_game());
 				} catch(Chess::Exception& exception) {
@@ -103,10 +147,7 @@ int main(int argc, char* argv[]) {
 				// Writes a game to a file
 				std::string argument;
 				std::cin >> argument;
-				std::ofstream ofs;
-				ofs.open( argument );
-				ofs << game;
-				ofs.close();
+				save_game(argument, game);
 				break;
 			}
 			case 'M': case 'm': {
@@ -129,6 +170,47 @@ int main(int argc, char* argv[]) {
 				}
 				break;
 			}
+			case 'C': case 'c': {
+				// Let the computer choose and make a move
+				Chess::SearchLimits limits;
+				limits.time_ms = computer_time_ms;
+				Chess::SearchResult result = engine.run(game, limits);
+				if (result.best_move == Chess::Move()) {
+					std::cerr << "There is no move to make" << std::endl;
+				} else {
+					game.make_move(result.best_move.start(), result.best_move.end());
+					if (result.from_book) {
+						std::cout << "Computer move: " << result.best_move.name() << " (book)" << std::endl;
+					} else {
+						std::cout << "Computer move: " << result.best_move.name() << " (depth " << result.depth
+						          << ", score " << result.score << ", nodes " << result.nodes
+						          << ", nps " << result.nps() << ")" << std::endl;
+					}
+				}
+				break;
+			}
+			case 'B': case 'b': {
+				// Open an opening book
+				std::string book_path;
+				std::cin >> book_path;
+				if (book.open(book_path)) {
+					engine.set_book(&book);
+					std::cout << "Opening book loaded: " << book.size() << " entries" << std::endl;
+				} else {
+					engine.set_book(nullptr);
+					std::cerr << "Cannot load the opening book!" << std::endl;
+				}
+				break;
+			}
+			case 'T': case 't': {
+				// Load endgame tablebases
+				std::string directory;
+				std::cin >> directory;
+				int added = tablebases.load_directory(directory);
+				engine.set_tablebases(tablebases.size() > 0 ? &tablebases : nullptr);
+				std::cout << "Endgame tables loaded: " << added << std::endl;
+				break;
+			}
 			default:
 				// Unrecognized command
 				std::cerr << "Invalid action '" << choice << "'" << std::endl;
@@ -138,10 +220,7 @@ int main(int argc, char* argv[]) {
 
 	// Write out the state of the game to a file
 	if (argc > 1) {
-		std::ofstream ofs;
-		ofs.open(argv[1]);
-		ofs << game;
-		ofs.close();
+		save_game(argv[1], game);
 	}
 
 	return 0;
@@ -0,0 +1,609 @@
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <csignal>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "Game.h"
+#include "PositionFile.h"
+#include "ThreadPool.h"
+
+// Plays games between two UCI engines, such as two builds of chess-uci, and
+// reports the score of the first engine with an Elo estimate. Each opening is
+// played twice, once with each engine as white. With --sprt the match stops as
+// soon as a sequential probability ratio test accepts either hypothesis.
+//
+// The engines only suggest moves: every game is kept in a Game, which checks
+// each move and decides checkmate, stalemate, the fifty-move rule, threefold
+// repetition and bare kings. An engine that plays an illegal move, runs out of
+// time or stops answering loses the game.
+
+// Played when no opening file is given: common replies to the main first moves
+static const char* const DEFAULT_OPENINGS[] = {
+	"rnbqkbnr/pppp1ppp/8/4p3/4P3/8/PPPP1PPP/RNBQKBNR w - - 0 2",
+	"rnbqkbnr/pp1ppppp/8/2p5/4P3/8/PPPP1PPP/RNBQKBNR w - - 0 2",
+	"rnbqkbnr/pppp1ppp/4p3/8/4P3/8/PPPP1PPP/RNBQKBNR w - - 0 2",
+	"rnbqkbnr/pp1ppppp/2p5/8/4P3/8/PPPP1PPP/RNBQKBNR w - - 0 2",
+	"rnbqkbnr/ppp1pppp/8/3p4/3P4/8/PPP1PPPP/RNBQKBNR w - - 0 2",
+	"rnbqkb1r/pppppppp/5n2/8/3P4/8/PPP1PPPP/RNBQKBNR w - - 1 2",
+	"rnbqkbnr/pppp1ppp/8/4p3/2P5/8/PP1PPPPP/RNBQKBNR w - - 0 2",
+	"rnbqkbnr/ppp1pppp/8/3p4/8/5N2/PPPPPPPP/RNBQKB1R w - - 1 2",
+};
+
+// How long past its clock an engine may take before it loses on time, and
+// how long it has to answer "uci" and "isready"
+static const long long TIME_MARGIN_MS = 100;
+static const long long HANDSHAKE_MS = 10000;
+
+void show_usage() {
+	std::cout << "Usage:" << std::endl;
+	std::cout << "\tmatch [options] <engine1> <engine2>" << std::endl;
+	std::cout << "\t                play games between two UCI engine commands, e.g. ./chess-uci" << std::endl;
+	std::cout << "Options:" << std::endl;
+	std::cout << "\t--games <n>             games to play, rounded up to pairs (default 100)" << std::endl;
+	std::cout << "\t--concurrency <n>       games played at once (default one per core)" << std::endl;
+	std::cout << "\t--tc <s>[+<inc>]        time and increment per game in seconds (default 10+0.1)" << std::endl;
+	std::cout << "\t--tc1, --tc2 <s>[+<inc>] the same for one engine only" << std::endl;
+	std::cout << "\t--openings <file>       starting positions: FEN records one per line, or a" << std::endl;
+	std::cout << "\t                        position file written by pgn-replay --positions" << std::endl;
+	std::cout << "\t--sprt <elo0> <elo1>    stop once engine1 is shown to be elo0 or elo1 stronger" << std::endl;
+	std::cout << "\t--alpha <a>, --beta <b> error rates of the test (default 0.05 each)" << std::endl;
+}
+
+struct TimeControl {
+	long long time_ms;
+	long long increment_ms;
+
+	TimeControl() : time_ms(10000), increment_ms(100) {}
+};
+
+// Reads "<seconds>[+<increment>]". Returns false if it is not a time control.
+static bool parse_time_control(const std::string& text, TimeControl& control) {
+	char* end = nullptr;
+	double seconds = std::strtod(text.c_str(), &end);
+	double increment = 0;
+	if (end == text.c_str() || seconds <= 0) {
+		return false;
+	}
+	if (*end == '+') {
+		const char* start = end + 1;
+		increment = std::strtod(start, &end);
+		if (end == start || increment < 0) {
+			return false;
+		}
+	}
+	if (*end != '\0') {
+		return false;
+	}
+	control.time_ms = static_cast<long long>(seconds * 1000);
+	control.increment_ms = static_cast<long long>(increment * 1000);
+	return true;
+}
+
+static long long milliseconds_since(std::chrono::steady_clock::time_point start) {
+	return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+}
+
+// A UCI engine running as a child process, talked to over two pipes
+class Engine {
+
+public:
+	explicit Engine(const std::string& command) : pid(-1), to_engine(-1), from_engine(-1) {
+		int input[2];
+		int output[2];
+		if (pipe2(input, O_CLOEXEC) < 0) {
+			return;
+		}
+		if (pipe2(output, O_CLOEXEC) < 0) {
+			close(input[0]);
+			close(input[1]);
+			return;
+		}
+		pid = fork();
+		if (pid == 0) {
+			// Only async-signal-safe calls between fork and exec
+			dup2(input[0], STDIN_FILENO);
+			dup2(output[1], STDOUT_FILENO);
+			execl("/bin/sh", "sh", "-c", command.c_str(), static_cast<char*>(nullptr));
+			_exit(127);
+		}
+		close(input[0]);
+		close(output[1]);
+		if (pid < 0) {
+			close(input[1]);
+			close(output[0]);
+			return;
+		}
+		to_engine = input[1];
+		from_engine = output[0];
+	}
+
+	~Engine() {
+		if (pid <= 0) {
+			return;
+		}
+		send("quit");
+		close(to_engine);
+		close(from_engine);
+
+		// Give it a moment to exit by itself before killing it
+		for (int i = 0; i < 100; i++) {
+			if (waitpid(pid, nullptr, WNOHANG) == pid) {
+				return;
+			}
+			std::this_thread::sleep_for(std::chrono::milliseconds(10));
+		}
+		kill(pid, SIGKILL);
+		waitpid(pid, nullptr, 0);
+	}
+
+	Engine(const Engine&) = delete;
+	Engine& operator=(const Engine&) = delete;
+
+	// Writes one line. Returns false if the engine has gone away.
+	bool send(const std::string& line) {
+		std::string text = line + "\n";
+		std::size_t written = 0;
+		while (written < text.size()) {
+			ssize_t n = write(to_engine, text.data() + written, text.size() - written);
+			if (n < 0 && errno == EINTR) {
+				continue;
+			}
+			if (n <= 0) {
+				return false;
+			}
+			written += static_cast<std::size_t>(n);
+		}
+		return true;
+	}
+
+	// Reads one line, waiting at most the given time. Returns false on timeout or end of output.
+	bool read_line(std::string& line, long long timeout_ms) {
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		for (;;) {
+			std::size_t end = buffer.find('\n');
+			if (end != std::string::npos) {
+				line = buffer.substr(0, end);
+				if (!line.empty() && line.back() == '\r') {
+					line.pop_back();
+				}
+				buffer.erase(0, end + 1);
+				return true;
+			}
+
+			long long remaining = timeout_ms - milliseconds_since(start);
+			if (remaining <= 0) {
+				return false;
+			}
+			pollfd ready = { from_engine, POLLIN, 0 };
+			int polled = poll(&ready, 1, static_cast<int>(std::min(remaining, 1000000LL)));
+			if (polled < 0 && errno == EINTR) {
+				continue;
+			}
+			if (polled <= 0) {
+				return false;
+			}
+			char chunk[4096];
+			ssize_t n = read(from_engine, chunk, sizeof(chunk));
+			if (n < 0 && errno == EINTR) {
+				continue;
+			}
+			if (n <= 0) {
+				return false;
+			}
+			buffer.append(chunk, static_cast<std::size_t>(n));
+		}
+	}
+
+	// Reads lines until one starts with the given word, and returns that line in found
+	bool wait_for(const std::string& word, long long timeout_ms, std::string& found) {
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		std::string line;
+		while (read_line(line, timeout_ms - milliseconds_since(start))) {
+			if (line.compare(0, word.size(), word) == 0 && (line.size() == word.size() || line[word.size()] == ' ')) {
+				found = line;
+				return true;
+			}
+		}
+		return false;
+	}
+
+	// Starts the protocol. Returns false if the engine does not answer.
+	bool start() {
+		std::string line;
+		return pid > 0 && send("uci") && wait_for("uciok", HANDSHAKE_MS, line);
+	}
+
+	// Sends "isready" and waits for the answer
+	bool ready() {
+		std::string line;
+		return send("isready") && wait_for("readyok", HANDSHAKE_MS, line);
+	}
+
+private:
+	pid_t pid;
+	int to_engine;
+	int from_engine;
+
+	// Output read but not yet returned as lines
+	std::string buffer;
+};
+
+enum Outcome { WHITE_WINS, BLACK_WINS, DRAW };
+
+struct GameResult {
+	Outcome outcome;
+	std::string reason;
+	int plies;
+
+	// Set if an engine failed and has to be restarted, the white one first
+	bool restart[2];
+};
+
+// Plays one game from the position and returns its result. engines[0] plays
+// white and engines[1] black, each with its own clock.
+static GameResult play_game(const std::string& fen, Engine* engines[2], const TimeControl controls[2]) {
+	GameResult result;
+	result.outcome = DRAW;
+	result.plies = 0;
+	result.restart[0] = false;
+	result.restart[1] = false;
+
+	Chess::Game game;
+	game.load_fen(fen);
+	for (int side = 0; side < 2; side++) {
+		if (!engines[side]->send("ucinewgame") || !engines[side]->ready()) {
+			result.outcome = side == 0 ? BLACK_WINS : WHITE_WINS;
+			result.reason = "engine did not start";
+			result.restart[side] = true;
+			return result;
+		}
+	}
+
+	// Clocks and engines are indexed by colour: 0 for white, 1 for black
+	long long clock[2] = { controls[0].time_ms, controls[1].time_ms };
+	std::string moves;
+	std::unordered_map<Chess::HashKey, int> seen;
+	seen[game.hash()]++;
+
+	for (;;) {
+		const bool white = game.turn_white();
+		const int side = white ? 0 : 1;
+		const Outcome loss = white ? BLACK_WINS : WHITE_WINS;
+
+		if (game.in_mate(white)) {
+			result.outcome = loss;
+			result.reason = "checkmate";
+			return result;
+		}
+		if (game.in_stalemate(white)) {
+			result.reason = "stalemate";
+			return result;
+		}
+		if (game.halfmove_clock() >= 100) {
+			result.reason = "fifty-move rule";
+			return result;
+		}
+		if (seen[game.hash()] >= 3) {
+			result.reason = "threefold repetition";
+			return result;
+		}
+		if (Chess::pop_count(game.occupancy()) == 2) {
+			result.reason = "insufficient material";
+			return result;
+		}
+
+		std::ostringstream go;
+		go << "go wtime " << std::max(clock[0], 0LL) << " btime " << std::max(clock[1], 0LL)
+		   << " winc " << controls[0].increment_ms << " binc " << controls[1].increment_ms;
+		std::string bestmove;
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		bool answered = engines[side]->send("position fen " + fen + (moves.empty() ? "" : " moves" + moves))
+		                && engines[side]->send(go.str())
+		                && engines[side]->wait_for("bestmove", clock[side] + TIME_MARGIN_MS, bestmove);
+		long long elapsed = milliseconds_since(start);
+
+		if (!answered || elapsed > clock[side] + TIME_MARGIN_MS) {
+			// It may still be thinking, so start a fresh one for the next game
+			result.outcome = loss;
+			result.reason = answered || elapsed >= clock[side] + TIME_MARGIN_MS ? "loss on time" : "engine stopped";
+			result.restart[side] = true;
+			return result;
+		}
+		clock[side] += controls[side].increment_ms - elapsed;
+
+		std::istringstream words(bestmove);
+		std::string text;
+		words >> text >> text;
+		Chess::Move move;
+		if (!game.find_uci_move(text, move)) {
+			result.outcome = loss;
+			result.reason = "illegal move " + text;
+			return result;
+		}
+		game.do_move(move);
+		moves += " " + text;
+		result.plies++;
+		seen[game.hash()]++;
+	}
+}
+
+// Wins, draws and losses of engine 1, with the statistics built on them
+struct MatchScore {
+	int wins;
+	int draws;
+	int losses;
+
+	MatchScore() : wins(0), draws(0), losses(0) {}
+
+	int games() const { return wins + draws + losses; }
+
+	// Mean score per game, from 0 to 1
+	double mean() const { return games() > 0 ? (wins + 0.5 * draws) / games() : 0.5; }
+
+	// Variance of the score of one game
+	double variance() const {
+		if (games() == 0) {
+			return 0;
+		}
+		double m = mean();
+		return (wins * (1 - m) * (1 - m) + draws * (0.5 - m) * (0.5 - m) + losses * m * m) / games();
+	}
+
+	// Log-likelihood ratio of engine 1 being elo1 rather than elo0 stronger,
+	// using a normal approximation to the distribution of the score
+	double llr(double elo0, double elo1) const {
+		double v = variance();
+		if (v <= 0) {
+			return 0;
+		}
+		double s0 = expected_score(elo0);
+		double s1 = expected_score(elo1);
+		return (s1 - s0) * (2 * mean() - s0 - s1) * games() / (2 * v);
+	}
+
+	static double expected_score(double elo) { return 1 / (1 + std::pow(10, -elo / 400)); }
+
+	static double elo(double score) { return -400 * std::log10(1 / score - 1); }
+};
+
+// Formats the Elo difference of the score and its 95% error margin
+static std::string elo_text(const MatchScore& score) {
+	std::ostringstream text;
+	double m = score.mean();
+	if (score.games() == 0 || m <= 0 || m >= 1) {
+		text << (m >= 1 ? "+inf" : m <= 0 ? "-inf" : "0");
+		return text.str();
+	}
+	double margin = 1.96 * std::sqrt(score.variance() / score.games());
+	double low = MatchScore::elo(std::max(m - margin, 1e-6));
+	double high = MatchScore::elo(std::min(m + margin, 1 - 1e-6));
+	text.setf(std::ios::fixed);
+	text.precision(1);
+	text << MatchScore::elo(m) << " +/- " << (high - low) / 2;
+	return text.str();
+}
+
+// Reads starting positions as FEN records, from a position file or a file of
+// one FEN per line. Returns false, after saying why, if the file cannot be read
+// or holds a record that is not a position.
+static bool read_openings(const std::string& path, std::vector<std::string>& openings) {
+	Chess::PositionFile positions(path.c_str());
+	if (positions.is_open()) {
+		for (std::size_t i = 0; i < positions.size(); i++) {
+			try {
+				Chess::Game game;
+				game.from_packed(positions[i]);
+				openings.push_back(game.to_fen());
+			} catch (Chess::Exception& exception) {
+				std::cerr << "Invalid opening record " << i + 1 << " in " << path << ": " << exception.what() << std::endl;
+				return false;
+			}
+		}
+		return true;
+	}
+
+	std::ifstream ifs(path);
+	if (!ifs) {
+		std::cerr << "Cannot read " << path << std::endl;
+		return false;
+	}
+	std::string line;
+	while (std::getline(ifs, line)) {
+		if (line.find('/') != std::string::npos) {
+			openings.push_back(line);
+		}
+	}
+	return true;
+}
+
+int main(int argc, char* argv[]) {
+	int games = 100;
+	int concurrency = static_cast<int>(std::thread::hardware_concurrency());
+	TimeControl controls[2];
+	std::string openings_path;
+	bool sprt = false;
+	double elo0 = 0;
+	double elo1 = 0;
+	double alpha = 0.05;
+	double beta = 0.05;
+	std::vector<std::string> commands;
+
+	for (int i = 1; i < argc; i++) {
+		std::string arg = argv[i];
+		bool valid = true;
+		if (arg == "--games" && i + 1 < argc) {
+			games = std::atoi(argv[++i]);
+		} else if (arg == "--concurrency" && i + 1 < argc) {
+			concurrency = std::atoi(argv[++i]);
+		} else if (arg == "--tc" && i + 1 < argc) {
+			valid = parse_time_control(argv[++i], controls[0]);
+			controls[1] = controls[0];
+		} else if ((arg == "--tc1" || arg == "--tc2") && i + 1 < argc) {
+			valid = parse_time_control(argv[++i], controls[arg == "--tc1" ? 0 : 1]);
+		} else if (arg == "--openings" && i + 1 < argc) {
+			openings_path = argv[++i];
+		} else if (arg == "--sprt" && i + 2 < argc) {
+			sprt = true;
+			elo0 = std::atof(argv[++i]);
+			elo1 = std::atof(argv[++i]);
+			valid = elo0 < elo1;
+		} else if (arg == "--alpha" && i + 1 < argc) {
+			alpha = std::atof(argv[++i]);
+			valid = alpha > 0 && alpha < 1;
+		} else if (arg == "--beta" && i + 1 < argc) {
+			beta = std::atof(argv[++i]);
+			valid = beta > 0 && beta < 1;
+		} else if (arg[0] != '-') {
+			commands.push_back(arg);
+		} else {
+			valid = false;
+		}
+		if (!valid) {
+			show_usage();
+			return 1;
+		}
+	}
+	if (commands.size() != 2 || games < 1) {
+		show_usage();
+		return 1;
+	}
+	if (concurrency < 1) {
+		concurrency = 1;
+	}
+	games += games % 2;
+
+	std::vector<std::string> openings;
+	if (openings_path.empty()) {
+		openings.assign(std::begin(DEFAULT_OPENINGS), std::end(DEFAULT_OPENINGS));
+	} else if (!read_openings(openings_path, openings)) {
+		return 1;
+	}
+	for (const std::string& fen : openings) {
+		try {
+			Chess::Game game;
+			game.load_fen(fen);
+		} catch (Chess::Exception& exception) {
+			std::cerr << "Invalid opening \"" << fen << "\": " << exception.what() << std::endl;
+			return 1;
+		}
+	}
+	if (openings.empty()) {
+		std::cerr << "No openings in " << openings_path << std::endl;
+		return 1;
+	}
+
+	// Writing to an engine that has exited must fail rather than end the match
+	std::signal(SIGPIPE, SIG_IGN);
+
+	const double lower_bound = std::log(beta / (1 - alpha));
+	const double upper_bound = std::log((1 - beta) / alpha);
+
+	// One pair of engines per worker thread, engine 1 first, started when first needed
+	std::vector<std::unique_ptr<Engine> > engines(2 * concurrency);
+
+	std::mutex score_mutex;
+	MatchScore score;
+	std::atomic<bool> finished(false);
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+	{
+		Chess::ThreadPool pool(concurrency);
+		for (int number = 0; number < games; number++) {
+			pool.submit([&, number] {
+				if (finished) {
+					return;
+				}
+				int worker = pool.worker_index();
+				for (int e = 0; e < 2; e++) {
+					std::unique_ptr<Engine>& engine = engines[2 * worker + e];
+					if (!engine) {
+						engine.reset(new Engine(commands[e]));
+						if (!engine->start()) {
+							std::lock_guard<std::mutex> lock(score_mutex);
+							std::cerr << "Engine " << e + 1 << " (" << commands[e] << ") did not start" << std::endl;
+							finished = true;
+							return;
+						}
+					}
+				}
+
+				// Even games give engine 1 white, and each pair shares an opening
+				const bool engine1_white = number % 2 == 0;
+				const std::string& fen = openings[(number / 2) % openings.size()];
+				Engine* players[2] = { engines[2 * worker].get(), engines[2 * worker + 1].get() };
+				TimeControl clocks[2] = { controls[0], controls[1] };
+				if (!engine1_white) {
+					std::swap(players[0], players[1]);
+					std::swap(clocks[0], clocks[1]);
+				}
+				GameResult result = play_game(fen, players, clocks);
+				for (int side = 0; side < 2; side++) {
+					if (result.restart[side]) {
+						engines[2 * worker + (engine1_white == (side == 0) ? 0 : 1)].reset();
+					}
+				}
+
+				std::lock_guard<std::mutex> lock(score_mutex);
+				if (finished) {
+					return;
+				}
+				const char* text = "1/2-1/2";
+				if (result.outcome == DRAW) {
+					score.draws++;
+				} else if ((result.outcome == WHITE_WINS) == engine1_white) {
+					score.wins++;
+					text = engine1_white ? "1-0" : "0-1";
+				} else {
+					score.losses++;
+					text = engine1_white ? "0-1" : "1-0";
+				}
+				std::cout << "Game " << number + 1 << " (opening " << (number / 2) % openings.size() + 1 << ", engine "
+				          << (engine1_white ? "1" : "2") << " white): " << text << " " << result.reason << ", "
+				          << result.plies << " plies. Score " << score.wins << "-" << score.losses << "-" << score.draws
+				          << ", Elo " << elo_text(score);
+				if (sprt) {
+					double llr = score.llr(elo0, elo1);
+					std::cout << ", LLR " << llr << " [" << lower_bound << ", " << upper_bound << "]";
+					finished = llr <= lower_bound || llr >= upper_bound;
+				}
+				std::cout << std::endl;
+			});
+		}
+		pool.wait();
+	}
+
+	std::cout << std::endl;
+	std::cout << "Engine 1: " << commands[0] << std::endl;
+	std::cout << "Engine 2: " << commands[1] << std::endl;
+	std::cout << "Games: " << score.games() << " (" << score.wins << " wins, " << score.losses << " losses, "
+	          << score.draws << " draws for engine 1) in " << milliseconds_since(start) / 1000 << " s" << std::endl;
+	std::cout << "Score: " << score.mean() * 100 << "%" << std::endl;
+	std::cout << "Elo: " << elo_text(score) << std::endl;
+	if (score.wins + score.losses > 0) {
+		double likelihood = 0.5 * (1 + std::erf((score.wins - score.losses) / std::sqrt(2.0 * (score.wins + score.losses))));
+		std::cout << "Likelihood of superiority: " << likelihood * 100 << "%" << std::endl;
+	}
+	if (sprt) {
+		double llr = score.llr(elo0, elo1);
+		std::cout << "SPRT (" << elo0 << ", " << elo1 << "): LLR " << llr << " [" << lower_bound << ", "
+		          << upper_bound << "], "
+		          << (llr >= upper_bound ? "H1 accepted" : llr <= lower_bound ? "H0 accepted" : "inconclusive") << std::endl;
+	}
+	return 0;
+}
@@ -0,0 +1,442 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "Game.h"
+#include "ThreadPool.h"
+
+// Counts the leaf nodes of the legal move tree below a position. Every move is
+// played in place with do_move and taken back with undo_move, and moves that
+// leave the mover's king in check are skipped.
+//
+// The work can be spread over a thread pool by cutting the tree a few moves
+// below the root, and subtree counts can be shared between threads through a
+// lock-free table keyed by the position hash and remaining depth.
+
+// Deepest allowed cut for splitting the tree into tasks
+static const int MAX_SPLIT_DEPTH = 4;
+
+// A position from the bundled suite, in the save file format read by operator>>,
+// with the expected node counts for depths 1 and up
+struct ReferencePosition {
+	const char* name;
+	const char* save;
+	int max_depth;
+	unsigned long long nodes[6];
+};
+
+// Expected counts follow this engine's rules: no castling, no en passant, and
+// pawns always promote to a queen, so they differ from standard tables for
+// positions where those moves are available.
+static const ReferencePosition SUITE[] = {
+	{ "start",
+	  "rnbqkbnr\npppppppp\n--------\n--------\n--------\n--------\nPPPPPPPP\nRNBQKBNR\nw",
+	  5, { 20, 400, 8902, 197281, 4865351 } },
+	{ "kiwipete",
+	  "r---k--r\np-ppqpb-\nbn--pnp-\n---PN---\n-p--P---\n--N--Q-p\nPPPBBPPP\nR---K--R\nw",
+	  3, { 46, 1865, 86585 } },
+	{ "rook endgame",
+	  "--------\n--p-----\n---p----\nKP-----r\n-R---p-k\n--------\n----P-P-\n--------\nw",
+	  4, { 14, 191, 2810, 43087 } },
+	{ "promotions",
+	  "n-n-----\nPPPk----\n--------\n--------\n--------\n--------\n----Kppp\n-----N-N\nb",
+	  4, { 15, 210, 3253, 47828 } },
+	{ "checks and pins",
+	  "r---k--r\nPppp-ppp\n-b---nbN\nnP------\nBBP-P---\nq----N--\nPp-P--PP\nR--Q-RK-\nw",
+	  3, { 6, 222, 7855 } },
+	{ "mystery pieces",
+	  "rnbqkbnr\npppp-ppp\n---m----\n----p---\n----P---\n----M---\nPPPP-PPP\nRNBQKBNR\nw",
+	  4, { 29, 664, 19469, 452860 } },
+	{ "king and pawn",
+	  "--------\n--------\n--------\n----k---\n--------\n--------\n---PK---\n-------R\nw",
+	  4, { 23, 165, 3291, 20391 } },
+};
+
+static const int SUITE_SIZE = sizeof(SUITE) / sizeof(SUITE[0]);
+
+// Settings taken from the command line
+struct Options {
+	// Number of worker threads
+	int threads;
+
+	// Depth below the root at which the tree is cut into tasks for the workers
+	int split_depth;
+
+	// Size of the shared subtree count table in megabytes, or 0 for none
+	std::size_t hash_mb;
+
+	// Repeat the count with 1, 2, 4, ... threads and report the speedup
+	bool scaling;
+
+	Options() : threads(1), split_depth(1), hash_mb(0), scaling(false) {}
+};
+
+// A lock-free table of subtree counts shared by all workers. Like the search
+// transposition table, each slot is two atomics: the packed count and depth,
+// and the position key XORed with them, so a torn write reads as a miss.
+class PerftTable {
+
+public:
+	explicit PerftTable(std::size_t megabytes) : mask(0) {
+		std::size_t wanted = megabytes * 1024 * 1024 / sizeof(Slot);
+		std::size_t count = 1;
+		while (count * 2 <= wanted) {
+			count *= 2;
+		}
+		slots.reset(new Slot[count]);
+		mask = count - 1;
+		for (std::size_t i = 0; i < count; i++) {
+			slots[i].check.store(0, std::memory_order_relaxed);
+			slots[i].data.store(0, std::memory_order_relaxed);
+		}
+	}
+
+	bool probe(Chess::HashKey key, int depth, unsigned long long& nodes) const {
+		const Slot& slot = slots[key & mask];
+		std::uint64_t data = slot.data.load(std::memory_order_relaxed);
+		std::uint64_t check = slot.check.load(std::memory_order_relaxed);
+		if ((check ^ data) != key || static_cast<int>(data & 0xFF) != depth) {
+			return false;
+		}
+		nodes = data >> 8;
+		return true;
+	}
+
+	void store(Chess::HashKey key, int depth, unsigned long long nodes) {
+		Slot& slot = slots[key & mask];
+		std::uint64_t data = (static_cast<std::uint64_t>(nodes) << 8) | static_cast<std::uint64_t>(depth);
+		slot.data.store(data, std::memory_order_relaxed);
+		slot.check.store(key ^ data, std::memory_order_relaxed);
+	}
+
+private:
+	struct Slot {
+		std::atomic<std::uint64_t> check;
+		std::atomic<std::uint64_t> data;
+	};
+
+	std::unique_ptr<Slot[]> slots;
+	std::size_t mask;
+};
+
+void show_usage() {
+	std::cout << "Usage:" << std::endl;
+	std::cout << "\tperft <depth> [<filename>] [<options>]" << std::endl;
+	std::cout << "\t                count leaf nodes to <depth> from the start position, or from" << std::endl;
+	std::cout << "\t                a game saved with 'S', and print the count for each first move" << std::endl;
+	std::cout << "\tperft --suite [<depth>] [<options>]" << std::endl;
+	std::cout << "\t                check the bundled reference positions, up to <depth> if given" << std::endl;
+	std::cout << "Options:" << std::endl;
+	std::cout << "\t--threads <n>   split the work over <n> threads, 0 for one per core (default 1)" << std::endl;
+	std::cout << "\t--split <d>     cut the tree into tasks <d> moves below the root (default 1)" << std::endl;
+	std::cout << "\t--hash <mb>     cache subtree counts in a shared table of <mb> megabytes" << std::endl;
+	std::cout << "\t--scaling       repeat the count with 1, 2, 4, ... up to <n> threads" << std::endl;
+	std::cout << "Build with 'make perft DEBUGGING_FLAGS=-O2' for meaningful nodes/sec figures." << std::endl;
+}
+unsigned long long perft(Chess::Game& game, int depth, PerftTable* table) {
+	if (depth == 0) {
+		return 1;
+	}
+
+	unsigned long long nodes = 0;
+	if (table != nullptr && depth > 1 && table->probe(game.hash(), depth, nodes)) {
+		return nodes;
+	}
+
+	const bool white = game.turn_white();
+	const Chess::MoveList moves = game.generate_pseudo_legal_moves();
+
+	for (const Chess::Move& move : moves) {
+		game.do_move(move);
+		if (!game.in_check(white)) {
+			nodes += depth == 1 ? 1 : perft(game, depth - 1, table);
+		}
+		game.undo_move();
+	}
+
+	if (table != nullptr && depth > 1) {
+		table->store(game.hash(), depth, nodes);
+	}
+	return nodes;
+}
+
+double seconds_since(std::chrono::steady_clock::time_point start) {
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+void print_speed(unsigned long long nodes, double seconds) {
+	std::cout << "Nodes: " << nodes << std::endl;
+	std::cout << "Time: " << static_cast<long long>(seconds * 1000) << " ms" << std::endl;
+	std::cout << "Nodes/sec: " << static_cast<long long>(seconds > 0 ? nodes / seconds : 0) << std::endl;
+}
+
+// A piece of work for one worker: the moves leading from the root to a
+// position at the split depth, and the root move they start with
+struct SplitTask {
+	int root;
+	int length;
+	Chess::Move path[MAX_SPLIT_DEPTH];
+};
+
+// Lists the legal move sequences of the given length below the current position
+void collect_tasks(Chess::Game& game, int root, int length, int split, SplitTask& current, std::vector<SplitTask>& tasks) {
+	if (length == split) {
+		current.root = root;
+		current.length = length;
+		tasks.push_back(current);
+		return;
+	}
+
+	const bool white = game.turn_white();
+	const Chess::MoveList moves = game.generate_pseudo_legal_moves();
+	for (const Chess::Move& move : moves) {
+		game.do_move(move);
+		if (!game.in_check(white)) {
+			current.path[length] = move;
+			collect_tasks(game, root, length + 1, split, current, tasks);
+		}
+		game.undo_move();
+	}
+}
+
+// Counts the leaf nodes below each legal root move, in the order the moves are
+// generated. The tree is cut into tasks at the split depth and the tasks are run
+// on a work-stealing pool. Each worker plays its tasks on its own copy of the
+// root position, so the totals are the same for any number of threads.
+std::vector<unsigned long long> count_by_root_move(const Chess::Game& root, int depth, const Options& options,
+                                                   int threads, std::vector<Chess::Move>& root_moves) {
+	const Chess::MoveList legal = root.generate_legal_moves();
+	root_moves.assign(legal.begin(), legal.end());
+	std::vector<unsigned long long> totals(root_moves.size(), 0);
+
+	std::unique_ptr<PerftTable> table;
+	if (options.hash_mb > 0) {
+		table.reset(new PerftTable(options.hash_mb));
+	}
+
+	// Never split at or below the leaves
+	const int split = std::max(1, std::min(options.split_depth, depth - 1));
+	if (depth <= 1) {
+		for (std::size_t i = 0; i < totals.size(); i++) {
+			totals[i] = 1;
+		}
+		return totals;
+	}
+
+	std::vector<SplitTask> tasks;
+	Chess::Game game(root);
+	for (std::size_t i = 0; i < root_moves.size(); i++) {
+		SplitTask current;
+		current.path[0] = root_moves[i];
+		game.do_move(root_moves[i]);
+		collect_tasks(game, static_cast<int>(i), 1, split, current, tasks);
+		game.undo_move();
+	}
+
+	std::unique_ptr<std::atomic<unsigned long long>[]> counts(new std::atomic<unsigned long long>[totals.size()]);
+	for (std::size_t i = 0; i < totals.size(); i++) {
+		counts[i].store(0);
+	}
+
+	{
+		Chess::ThreadPool pool(threads);
+		std::vector<Chess::Game> games(pool.size(), root);
+		PerftTable* shared = table.get();
+
+		for (const SplitTask& task : tasks) {
+			pool.submit([&pool, &games, &counts, shared, depth, split, &task] {
+				Chess::Game& local = games[pool.worker_index()];
+				for (int i = 0; i < task.length; i++) {
+					local.do_move(task.path[i]);
+				}
+				counts[task.root] += perft(local, depth - split, shared);
+				for (int i = 0; i < task.length; i++) {
+					local.undo_move();
+				}
+			});
+		}
+		pool.wait();
+	}
+
+	for (std::size_t i = 0; i < totals.size(); i++) {
+		totals[i] = counts[i].load();
+	}
+	return totals;
+}
+
+unsigned long long count_nodes(const Chess::Game& root, int depth, const Options& options, int threads) {
+	std::vector<Chess::Move> root_moves;
+	std::vector<unsigned long long> totals = count_by_root_move(root, depth, options, threads, root_moves);
+	unsigned long long total = 0;
+	for (unsigned long long nodes : totals) {
+		total += nodes;
+	}
+	return total;
+}
+
+// Prints the number of leaf nodes below each legal first move, then the total
+int divide(const Chess::Game& game, int depth, const Options& options) {
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	std::vector<Chess::Move> root_moves;
+	std::vector<unsigned long long> totals = count_by_root_move(game, depth, options, options.threads, root_moves);
+	double seconds = seconds_since(start);
+
+	unsigned long long total = 0;
+	for (std::size_t i = 0; i < root_moves.size(); i++) {
+		std::cout << root_moves[i].name() << ": " << totals[i] << std::endl;
+		total += totals[i];
+	}
+
+	std::cout << std::endl;
+	print_speed(total, seconds);
+	return 0;
+}
+
+// Repeats the count with a growing number of threads and compares each run
+// with the single-threaded one
+int report_scaling(const Chess::Game& game, int depth, const Options& options) {
+	int max_threads = options.threads > 0 ? options.threads : static_cast<int>(std::thread::hardware_concurrency());
+	max_threads = std::max(max_threads, 1);
+
+	std::cout << "Threads  Nodes  Time (ms)  Nodes/sec  Speedup  Efficiency" << std::endl;
+	double base_seconds = 0;
+	unsigned long long base_nodes = 0;
+	for (int threads = 1; ; threads = std::min(threads * 2, max_threads)) {
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		unsigned long long nodes = count_nodes(game, depth, options, threads);
+		double seconds = seconds_since(start);
+		if (threads == 1) {
+			base_seconds = seconds;
+			base_nodes = nodes;
+		}
+
+		double speedup = seconds > 0 ? base_seconds / seconds : 0;
+		std::cout << threads << "  " << nodes << "  " << static_cast<long long>(seconds * 1000) << "  "
+		          << static_cast<long long>(seconds > 0 ? nodes / seconds : 0) << "  " << speedup << "  "
+		          << static_cast<int>(100 * speedup / threads) << "%" << std::endl;
+
+		if (nodes != base_nodes) {
+			std::cout << "Count differs from the single-threaded count " << base_nodes << std::endl;
+			return 1;
+		}
+		if (threads == max_threads) {
+			break;
+		}
+	}
+	return 0;
+}
+
+// Runs every reference position and reports any count that does not match
+int run_suite(int max_depth, const Options& options) {
+	int failures = 0;
+	unsigned long long total = 0;
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+	for (int i = 0; i < SUITE_SIZE; i++) {
+		Chess::Game game;
+		std::istringstream iss(SUITE[i].save);
+		iss >> game;
+
+		for (int depth = 1; depth <= SUITE[i].max_depth && depth <= max_depth; depth++) {
+			unsigned long long nodes = count_nodes(game, depth, options, options.threads);
+			unsigned long long expected = SUITE[i].nodes[depth - 1];
+			total += nodes;
+
+			std::cout << SUITE[i].name << " depth " << depth << ": " << nodes;
+			if (nodes == expected) {
+				std::cout << " ok" << std::endl;
+			} else {
+				std::cout << " FAILED, expected " << expected << std::endl;
+				failures++;
+			}
+		}
+	}
+
+	std::cout << std::endl;
+	print_speed(total, seconds_since(start));
+	if (failures > 0) {
+		std::cout << failures << " count(s) did not match" << std::endl;
+		return 1;
+	}
+	std::cout << "All counts match" << std::endl;
+	return 0;
+}
+
+// Reads the options that follow the positional arguments. Returns false on an unknown option.
+bool parse_options(int argc, char* argv[], int first, Options& options, std::vector<std::string>& positional) {
+	for (int i = first; i < argc; i++) {
+		std::string arg = argv[i];
+		if (arg == "--threads" && i + 1 < argc) {
+			options.threads = std::atoi(argv[++i]);
+			if (options.threads <= 0) {
+				options.threads = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+			}
+		} else if (arg == "--split" && i + 1 < argc) {
+			options.split_depth = std::max(1, std::min(std::atoi(argv[++i]), MAX_SPLIT_DEPTH));
+		} else if (arg == "--hash" && i + 1 < argc) {
+			options.hash_mb = static_cast<std::size_t>(std::atoi(argv[++i]));
+		} else if (arg == "--scaling") {
+			options.scaling = true;
+		} else if (arg.compare(0, 2, "--") == 0) {
+			return false;
+		} else {
+			positional.push_back(arg);
+		}
+	}
+	return true;
+}
+
+int main(int argc, char* argv[]) {
+	if (argc < 2) {
+		show_usage();
+		return 1;
+	}
+
+	Options options;
+	std::vector<std::string> positional;
+	if (!parse_options(argc, argv, 2, options, positional)) {
+		show_usage();
+		return 1;
+	}
+
+	if (std::strcmp(argv[1], "--suite") == 0) {
+		return run_suite(positional.empty() ? 6 : std::atoi(positional[0].c_str()), options);
+	}
+
+	int depth = std::atoi(argv[1]);
+	if (depth < 1) {
+		show_usage();
+		return 1;
+	}
+
+	Chess::Game game;
+	if (!positional.empty()) {
+		try {
+			std::ifstream ifs;
+			ifs.open(positional[0]);
+			ifs >> game;
+			ifs.close();
+		} catch (Chess::Exception& exception) {
+			std::cerr << "Cannot load the game!" << std::endl;
+			return 1;
+		}
+		if (!game.is_valid_game()) {
+			std::cerr << "Cannot load the game!" << std::endl;
+			return 1;
+		}
+	}
+
+	if (options.scaling) {
+		return report_scaling(game, depth, options);
+	}
+	return divide(game, depth, options);
+}
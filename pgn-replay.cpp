@@ -0,0 +1,634 @@
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+#include "BoundedQueue.h"
+#include "Game.h"
+#include "MappedFile.h"
+#include "PositionFile.h"
+
+// Replays the games of PGN files through the rules of this engine and reports,
+// for every game, whether each move was legal here.
+//
+// One thread cuts the input into games, a pool of workers replays them, and the
+// main thread prints one record per game, in input order. The threads are linked
+// by bounded queues, and a worker only starts a game within --queue games of the
+// next one to be printed, so memory use stays flat however large the archive is.
+// Files are memory-mapped and games are handed to the workers as views into the
+// mapping; standard input is read line by line instead.
+//
+// Moves are checked with the same rules as Game::make_move, so games that castle,
+// capture en passant or underpromote are reported as errors at that move.
+
+// The text of one game: its tag pairs followed by its movetext
+struct PgnGame {
+	long index;
+
+	// Games from a mapped file point into the mapping; games read from a
+	// stream keep their own copy of the text
+	std::string_view mapped;
+	std::string owned;
+
+	std::string_view text() const { return owned.empty() ? mapped : std::string_view(owned); }
+};
+
+// The outcome of replaying one game
+struct ReplayRecord {
+	long index;
+	bool ok;
+	int plies;
+
+	// The Result tag, or '*' if there is none
+	std::string result;
+
+	// The final state of the game, or what went wrong
+	std::string detail;
+
+	// With --positions, every position reached, starting with the first
+	std::vector<Chess::PackedPosition> positions;
+};
+
+// Holds workers back from games too far ahead of the output. Records are printed
+// in input order, so one slow game makes every record after it wait; a worker
+// may start game n only once n < next + size, where next is the next game to be
+// printed, which keeps at most size records waiting.
+struct ReorderWindow {
+	explicit ReorderWindow(long size) : size(size), next(1) {}
+
+	// Waits until the game may be started
+	void wait_for(long index) {
+		std::unique_lock<std::mutex> lock(mutex);
+		moved.wait(lock, [&] { return index < next + size; });
+	}
+
+	// Records that every game before next_index has been printed
+	void advance(long next_index) {
+		std::lock_guard<std::mutex> lock(mutex);
+		next = next_index;
+		moved.notify_all();
+	}
+
+	const long size;
+	long next;
+	std::mutex mutex;
+	std::condition_variable moved;
+};
+
+// A SAN move taken apart, e.g. "Nbxd7" is a knight from column B to D7
+struct SanMove {
+	Chess::PieceType piece;
+	int to;
+
+	// Disambiguation, or -1 if not given
+	int from_col;
+	int from_row;
+
+	// Designator of the promotion piece, or 0
+	char promotion;
+};
+
+void show_usage() {
+	std::cout << "Usage:" << std::endl;
+	std::cout << "\tpgn-replay [--threads <n>] [--queue <n>] [--errors-only] [--no-mmap] [--positions <out>] <file>..." << std::endl;
+	std::cout << "\t                replay every game of the PGN files (or standard input for '-')" << std::endl;
+	std::cout << "\t                on <n> worker threads (default one per core), with at most" << std::endl;
+	std::cout << "\t                <n> games waiting between threads (default 256), and write" << std::endl;
+	std::cout << "\t                every position reached to the position file <out>" << std::endl;
+}
+
+static bool is_space(char c) {
+	return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+// True for a tag pair line such as [Event "..."]
+static bool is_tag_line(std::string_view line) {
+	std::size_t first = 0;
+	while (first < line.size() && is_space(line[first])) {
+		first++;
+	}
+	return first < line.size() && line[first] == '[';
+}
+
+static bool is_blank(std::string_view line) {
+	for (char c : line) {
+		if (!is_space(c)) {
+			return false;
+		}
+	}
+	return true;
+}
+
+// Returns the next line of the text, without its newline, and moves past it
+static std::string_view next_line(std::string_view& rest) {
+	std::size_t end = rest.find('\n');
+	std::string_view line = rest.substr(0, end);
+	rest.remove_prefix(end == std::string_view::npos ? rest.size() : end + 1);
+	return line;
+}
+
+// Cuts mapped text into games. A game ends where a tag pair follows movetext.
+static bool split_mapped(std::string_view contents, long& next_index, Chess::BoundedQueue<PgnGame>& games) {
+	std::string_view rest = contents;
+	const char* game_begin = contents.data();
+	bool in_movetext = false;
+
+	while (!rest.empty()) {
+		const char* line_begin = rest.data();
+		std::string_view line = next_line(rest);
+		if (is_tag_line(line)) {
+			if (in_movetext) {
+				PgnGame game;
+				game.index = next_index++;
+				game.mapped = std::string_view(game_begin, static_cast<std::size_t>(line_begin - game_begin));
+				if (!games.push(std::move(game))) {
+					return false;
+				}
+				game_begin = line_begin;
+				in_movetext = false;
+			}
+		} else if (!is_blank(line)) {
+			in_movetext = true;
+		}
+	}
+
+	std::string_view last(game_begin, static_cast<std::size_t>(contents.data() + contents.size() - game_begin));
+	if (!is_blank(last)) {
+		PgnGame game;
+		game.index = next_index++;
+		game.mapped = last;
+		return games.push(std::move(game));
+	}
+	return true;
+}
+
+// Cuts a stream into games in the same way, copying each game's text
+static bool split_stream(std::istream& is, long& next_index, Chess::BoundedQueue<PgnGame>& games) {
+	std::string text;
+	std::string line;
+	bool in_movetext = false;
+
+	while (std::getline(is, line)) {
+		if (is_tag_line(line)) {
+			if (in_movetext) {
+				PgnGame game;
+				game.index = next_index++;
+				game.owned.swap(text);
+				if (!games.push(std::move(game))) {
+					return false;
+				}
+				text.clear();
+				in_movetext = false;
+			}
+		} else if (!is_blank(line)) {
+			in_movetext = true;
+		}
+		text += line;
+		text += '\n';
+	}
+
+	if (!is_blank(text)) {
+		PgnGame game;
+		game.index = next_index++;
+		game.owned.swap(text);
+		return games.push(std::move(game));
+	}
+	return true;
+}
+
+// Takes a SAN move apart. Returns nullptr on success, or why it is not a move.
+static const char* parse_san(std::string_view san, SanMove& move) {
+	while (!san.empty() && std::strchr("+#!?", san.back()) != nullptr) {
+		san.remove_suffix(1);
+	}
+	if (san.empty()) {
+		return "empty move";
+	}
+	if (san.substr(0, 3) == "O-O" || san.substr(0, 3) == "0-0") {
+		return "castling is not supported";
+	}
+	if (san == "--") {
+		return "null moves are not supported";
+	}
+
+	move.piece = Chess::PAWN;
+	move.from_col = move.from_row = -1;
+	move.promotion = 0;
+
+	switch (san.front()) {
+	case 'N': move.piece = Chess::KNIGHT; break;
+	case 'B': move.piece = Chess::BISHOP; break;
+	case 'R': move.piece = Chess::ROOK; break;
+	case 'Q': move.piece = Chess::QUEEN; break;
+	case 'K': move.piece = Chess::KING; break;
+	default: break;
+	}
+	if (move.piece != Chess::PAWN) {
+		san.remove_prefix(1);
+	}
+
+	// A trailing piece letter, with or without '=', is a promotion
+	if (!san.empty() && std::strchr("NBRQ", san.back()) != nullptr) {
+		if (move.piece != Chess::PAWN) {
+			return "only pawns can promote";
+		}
+		move.promotion = san.back();
+		san.remove_suffix(1);
+		if (!san.empty() && san.back() == '=') {
+			san.remove_suffix(1);
+		}
+	}
+
+	// What is left is the origin hint, if any, and the destination. Capture
+	// marks and the dash of long algebraic moves are skipped.
+	char squares[4];
+	int count = 0;
+	for (char c : san) {
+		if (c == 'x' || c == ':' || c == '-') {
+			continue;
+		}
+		if (count == 4) {
+			return "not a move";
+		}
+		squares[count++] = c;
+	}
+	if (count < 2) {
+		return "not a move";
+	}
+
+	char col = squares[count - 2];
+	char row = squares[count - 1];
+	if (col < 'a' || col > 'h' || row < '1' || row > '8') {
+		return "not a move";
+	}
+	move.to = (row - '1') * 8 + (col - 'a');
+
+	for (int i = 0; i < count - 2; i++) {
+		if (squares[i] >= 'a' && squares[i] <= 'h') {
+			move.from_col = squares[i] - 'a';
+		} else if (squares[i] >= '1' && squares[i] <= '8') {
+			move.from_row = squares[i] - '1';
+		} else {
+			return "not a move";
+		}
+	}
+	return nullptr;
+}
+
+// Finds the one move that matches the SAN move and plays it. Each candidate is
+// checked with Game::validate_move, the rule check behind make_move, and the
+// winner is played with do_move, which is what make_move does next. Returns
+// nullptr on success, or why the move could not be played.
+static const char* play_san(Chess::Game& game, const SanMove& san) {
+	Chess::MoveList moves = game.generate_pseudo_legal_moves();
+	Chess::Move found;
+	int matches = 0;
+	Chess::MoveError rejected = Chess::MOVE_OK;
+
+	for (const Chess::Move& move : moves) {
+		if (move.to() != san.to
+		    || (san.from_col >= 0 && move.from() % 8 != san.from_col)
+		    || (san.from_row >= 0 && move.from() / 8 != san.from_row)) {
+			continue;
+		}
+		const Chess::Piece* piece = game.piece_at(move.start());
+		if (Chess::piece_type(Chess::piece_index(piece->to_ascii())) != san.piece) {
+			continue;
+		}
+		Chess::MoveError error = game.validate_move(move.start(), move.end());
+		if (error != Chess::MOVE_OK) {
+			rejected = error;
+			continue;
+		}
+		found = move;
+		matches++;
+	}
+
+	if (matches == 0) {
+		return rejected != Chess::MOVE_OK ? Chess::move_error_message(rejected) : "no piece can make this move";
+	}
+	if (matches > 1) {
+		return "ambiguous move";
+	}
+	if (san.promotion != 0 && !found.is_promotion()) {
+		return "promotion on a move that does not promote";
+	}
+	if (found.is_promotion() && san.promotion != 0 && san.promotion != 'Q') {
+		return "only promotion to a queen is supported";
+	}
+
+	game.do_move(found);
+	return nullptr;
+}
+
+// Reads the value of a tag pair line, e.g. 1-0 from [Result "1-0"]
+static std::string_view tag_value(std::string_view line) {
+	std::size_t open = line.find('"');
+	std::size_t close = line.rfind('"');
+	if (open == std::string_view::npos || close == open) {
+		return std::string_view();
+	}
+	return line.substr(open + 1, close - open - 1);
+}
+
+// Returns the tag name, e.g. Result from [Result "1-0"]
+static std::string_view tag_name(std::string_view line) {
+	std::size_t open = line.find('[');
+	std::size_t end = open + 1;
+	while (end < line.size() && !is_space(line[end]) && line[end] != '"' && line[end] != ']') {
+		end++;
+	}
+	return line.substr(open + 1, end - open - 1);
+}
+
+// Adds the position to the record, unless it has too many pieces to pack
+static void keep_position(const Chess::Game& game, ReplayRecord& record) {
+	try {
+		record.positions.push_back(game.to_packed());
+	} catch (Chess::Exception&) {
+	}
+}
+
+static ReplayRecord replay_game(const PgnGame& pgn, bool keep_positions) {
+	ReplayRecord record;
+	record.index = pgn.index;
+	record.ok = false;
+	record.plies = 0;
+	record.result = "*";
+
+	Chess::Game game;
+	std::string_view rest = pgn.text();
+
+	// Tag pairs come first; only the result and a starting FEN matter here
+	while (!rest.empty()) {
+		std::string_view before = rest;
+		std::string_view line = next_line(rest);
+		if (is_blank(line)) {
+			continue;
+		}
+		if (!is_tag_line(line)) {
+			rest = before;
+			break;
+		}
+		std::string_view name = tag_name(line);
+		if (name == "Result") {
+			record.result = std::string(tag_value(line));
+		} else if (name == "FEN") {
+			try {
+				game.load_fen(tag_value(line));
+			} catch (Chess::Exception& exception) {
+				record.detail = std::string("bad FEN tag: ") + exception.what();
+				return record;
+			}
+		}
+	}
+
+	if (keep_positions) {
+		keep_position(game, record);
+	}
+
+	// Movetext: moves, move numbers, comments, variations, annotations and the result
+	int variation_depth = 0;
+	std::size_t i = 0;
+	while (i < rest.size()) {
+		char c = rest[i];
+		if (is_space(c)) {
+			i++;
+			continue;
+		}
+		if (c == '{' || c == ';') {
+			i = rest.find(c == '{' ? '}' : '\n', i);
+			if (i == std::string_view::npos) {
+				break;
+			}
+			i++;
+			continue;
+		}
+		if (c == '(' || c == ')') {
+			variation_depth += c == '(' ? 1 : -1;
+			i++;
+			continue;
+		}
+
+		std::size_t end = i;
+		while (end < rest.size() && !is_space(rest[end]) && std::strchr("{}();", rest[end]) == nullptr) {
+			end++;
+		}
+		std::string_view token = rest.substr(i, end - i);
+		i = end;
+
+		// Moves inside variations and numeric annotations are not part of the game
+		if (variation_depth > 0 || token[0] == '$') {
+			continue;
+		}
+		if (token == "1-0" || token == "0-1" || token == "1/2-1/2" || token == "*") {
+			break;
+		}
+
+		// Strip a move number such as "12." or "12...", but not the 0 of castling
+		// written with zeros, "0-0", which then fails as castling rather than as "-0"
+		std::size_t digits = 0;
+		while (digits < token.size() && token[digits] >= '0' && token[digits] <= '9') {
+			digits++;
+		}
+		if (digits > 0 && digits < token.size() && token[digits] == '.') {
+			while (digits < token.size() && token[digits] == '.') {
+				digits++;
+			}
+			token.remove_prefix(digits);
+		}
+		if (token.empty()) {
+			continue;
+		}
+
+		SanMove san;
+		const char* error = parse_san(token, san);
+		if (error == nullptr) {
+			error = play_san(game, san);
+		}
+		if (error != nullptr) {
+			record.detail = "error at ply " + std::to_string(record.plies + 1) + " (" + std::string(token) + "): " + error;
+			return record;
+		}
+		record.plies++;
+		if (keep_positions) {
+			keep_position(game, record);
+		}
+	}
+
+	record.ok = true;
+	bool white = game.turn_white();
+	if (game.in_mate(white)) {
+		record.detail = "checkmate";
+	} else if (game.in_stalemate(white)) {
+		record.detail = "stalemate";
+	} else {
+		record.detail = "game not over";
+	}
+	return record;
+}
+
+int main(int argc, char* argv[]) {
+	int threads = static_cast<int>(std::thread::hardware_concurrency());
+	int queue_size = 256;
+	bool errors_only = false;
+	bool use_mmap = true;
+	std::string positions_path;
+	std::vector<std::string> files;
+
+	for (int i = 1; i < argc; i++) {
+		std::string arg = argv[i];
+		if (arg == "--threads" && i + 1 < argc) {
+			threads = std::atoi(argv[++i]);
+		} else if (arg == "--queue" && i + 1 < argc) {
+			queue_size = std::atoi(argv[++i]);
+		} else if (arg == "--errors-only") {
+			errors_only = true;
+		} else if (arg == "--no-mmap") {
+			use_mmap = false;
+		} else if (arg == "--positions" && i + 1 < argc) {
+			positions_path = argv[++i];
+		} else if (arg == "-" || arg[0] != '-') {
+			files.push_back(arg);
+		} else {
+			show_usage();
+			return 1;
+		}
+	}
+	if (files.empty()) {
+		show_usage();
+		return 1;
+	}
+	if (threads < 1) {
+		threads = 1;
+	}
+	if (queue_size < 1) {
+		queue_size = 1;
+	}
+
+	// Mapped files stay open until every worker is done with their games
+	std::vector<std::unique_ptr<Chess::MappedFile> > mappings;
+	for (const std::string& file : files) {
+		if (file != "-" && use_mmap) {
+			mappings.emplace_back(new Chess::MappedFile(file.c_str()));
+			if (!mappings.back()->is_open()) {
+				std::cerr << "Cannot open " << file << std::endl;
+				return 1;
+			}
+		} else {
+			mappings.emplace_back();
+		}
+	}
+
+	Chess::PositionWriter positions;
+	if (!positions_path.empty() && !positions.open(positions_path)) {
+		std::cerr << "Cannot write " << positions_path << std::endl;
+		return 1;
+	}
+
+	Chess::BoundedQueue<PgnGame> games(queue_size);
+	Chess::BoundedQueue<ReplayRecord> records(queue_size);
+	ReorderWindow window(queue_size);
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+	std::thread reader([&] {
+		long next_index = 1;
+		for (std::size_t i = 0; i < files.size(); i++) {
+			if (mappings[i]) {
+				split_mapped(mappings[i]->contents(), next_index, games);
+			} else if (files[i] == "-") {
+				split_stream(std::cin, next_index, games);
+			} else {
+				std::ifstream ifs(files[i]);
+				if (!ifs) {
+					std::cerr << "Cannot open " << files[i] << std::endl;
+					continue;
+				}
+				split_stream(ifs, next_index, games);
+			}
+		}
+		games.close();
+	});
+
+	std::vector<std::thread> workers;
+	std::atomic<int> running(threads);
+	for (int id = 0; id < threads; id++) {
+		workers.push_back(std::thread([&] {
+			PgnGame game;
+			while (games.pop(game)) {
+				// The game just before the window is taken, or already done,
+				// since games are handed out in order
+				window.wait_for(game.index);
+				records.push(replay_game(game, positions.is_open()));
+			}
+			// The last worker to finish ends the output
+			if (--running == 0) {
+				records.close();
+			}
+		}));
+	}
+
+	// Records arrive in the order games finish; hold early ones back so the
+	// output follows the input. The window keeps this map to --queue records.
+	std::map<long, ReplayRecord> waiting;
+	long next_record = 1;
+	long total = 0;
+	long failed = 0;
+	long long plies = 0;
+	ReplayRecord record;
+	while (records.pop(record)) {
+		const long first_waiting = next_record;
+		waiting[record.index] = std::move(record);
+		for (std::map<long, ReplayRecord>::iterator it = waiting.find(next_record); it != waiting.end();
+		     it = waiting.find(next_record)) {
+			const ReplayRecord& done = it->second;
+			total++;
+			plies += done.plies;
+			if (!done.ok) {
+				failed++;
+			}
+			for (const Chess::PackedPosition& position : done.positions) {
+				positions.write(position);
+			}
+			if (!done.ok || !errors_only) {
+				std::cout << "Game " << done.index << ": " << (done.ok ? "ok, " : "")
+				          << done.plies << " plies, result " << done.result << ", " << done.detail << std::endl;
+			}
+			waiting.erase(it);
+			next_record++;
+		}
+		if (next_record != first_waiting) {
+			window.advance(next_record);
+		}
+	}
+
+	reader.join();
+	for (std::thread& worker : workers) {
+		worker.join();
+	}
+
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	std::cout << std::endl;
+	std::cout << "Games: " << total << " (" << total - failed << " ok, " << failed << " with errors)" << std::endl;
+	std::cout << "Plies: " << plies << std::endl;
+	if (positions.is_open()) {
+		std::cout << "Positions: " << positions.size() << std::endl;
+		if (!positions.close()) {
+			std::cerr << "Cannot write " << positions_path << std::endl;
+			return 1;
+		}
+	}
+	std::cout << "Threads: " << threads << std::endl;
+	std::cout << "Time: " << static_cast<long long>(seconds * 1000) << " ms" << std::endl;
+	std::cout << "Games/sec: " << static_cast<long long>(seconds > 0 ? total / seconds : 0) << std::endl;
+	return failed == 0 ? 0 : 2;
+}
@@ -0,0 +1,256 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "Game.h"
+#include "PositionDatabase.h"
+#include "PositionFile.h"
+
+// Builds and queries an indexed position database.
+//
+// "build" reads position files (such as those written by pgn-replay
+// --positions, which is how games in PGN are imported), files of FEN records
+// one per line, and games saved with the 'S' command. "find" lists the stored
+// copies of one position and "material" the positions with a given material
+// signature; both are binary searches over the memory-mapped database.
+
+void show_usage() {
+	std::cout << "Usage:" << std::endl;
+	std::cout << "\tposdb build <db> <file>...   index the positions of position files (.pos)," << std::endl;
+	std::cout << "\t                             FEN files (one record per line) and saved games" << std::endl;
+	std::cout << "\tposdb find <db> <position> [--limit <n>]" << std::endl;
+	std::cout << "\t                             list the rows holding a position, given as a FEN" << std::endl;
+	std::cout << "\t                             record or the name of a FEN or saved game file" << std::endl;
+	std::cout << "\tposdb material <db> <signature> [--limit <n>]" << std::endl;
+	std::cout << "\t                             list the rows with the material, e.g. KRPkr" << std::endl;
+	std::cout << "\tposdb stats <db>             show the row count and the most common signatures" << std::endl;
+}
+
+static double milliseconds_since(std::chrono::steady_clock::time_point start) {
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Adds the positions of one input file. Returns the number added, or -1 if it cannot be read.
+static long import_file(const std::string& path, Chess::PositionDatabaseBuilder& builder) {
+	Chess::PositionFile positions(path.c_str());
+	if (positions.is_open()) {
+		for (const Chess::PackedPosition& position : positions) {
+			builder.add(position);
+		}
+		return static_cast<long>(positions.size());
+	}
+
+	std::ifstream ifs(path);
+	if (!ifs) {
+		return -1;
+	}
+	std::string contents((std::istreambuf_iterator<char>(ifs)), std::istreambuf_iterator<char>());
+	Chess::Game game;
+	long added = 0;
+
+	// FEN separates the rows with '/', which the save format never uses
+	if (contents.find('/') == std::string::npos) {
+		std::istringstream iss(contents);
+		iss >> game;
+		builder.add(game.to_packed());
+		return 1;
+	}
+
+	std::string_view rest(contents);
+	while (!rest.empty()) {
+		std::size_t end = rest.find('\n');
+		std::string_view line = rest.substr(0, end);
+		rest = end == std::string_view::npos ? std::string_view() : rest.substr(end + 1);
+		if (line.find('/') == std::string_view::npos) {
+			continue;
+		}
+		try {
+			game.load_fen(line);
+			builder.add(game.to_packed());
+			added++;
+		} catch (Chess::Exception& exception) {
+			std::cerr << path << ": skipping \"" << line << "\": " << exception.what() << std::endl;
+		}
+	}
+	return added;
+}
+
+static int build(const std::string& db_path, const std::vector<std::string>& inputs) {
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	Chess::PositionDatabaseBuilder builder;
+	for (const std::string& input : inputs) {
+		try {
+			long added = import_file(input, builder);
+			if (added < 0) {
+				std::cerr << "Cannot read " << input << std::endl;
+				return 1;
+			}
+			std::cout << input << ": " << added << " positions" << std::endl;
+		} catch (Chess::Exception& exception) {
+			std::cerr << input << ": " << exception.what() << std::endl;
+			return 1;
+		}
+	}
+	if (!builder.write(db_path)) {
+		std::cerr << "Cannot write " << db_path << std::endl;
+		return 1;
+	}
+	std::cout << "Indexed " << builder.size() << " positions in " << static_cast<long long>(milliseconds_since(start))
+	          << " ms" << std::endl;
+	return 0;
+}
+
+// Prints one row: its number and the position as FEN, or why the record cannot be read
+static void print_row(const Chess::PositionDatabase& db, std::uint64_t row) {
+	Chess::Game game;
+	try {
+		game.from_packed(db.record(row));
+	} catch (Chess::Exception& exception) {
+		std::cout << row << "\t" << exception.what() << std::endl;
+		return;
+	}
+	std::cout << row << "\t" << game.to_fen() << std::endl;
+}
+
+// Reads a position from the command line: a FEN record, or a file holding one or a saved game
+static bool read_position(const std::string& argument, Chess::Game& game) {
+	try {
+		if (argument.find('/') != std::string::npos && argument.find(' ') != std::string::npos) {
+			game.load_fen(argument);
+			return true;
+		}
+		std::ifstream ifs(argument);
+		if (!ifs) {
+			return false;
+		}
+		std::string contents((std::istreambuf_iterator<char>(ifs)), std::istreambuf_iterator<char>());
+		if (contents.find('/') != std::string::npos) {
+			std::string_view record(contents);
+			game.load_fen(record.substr(0, record.find('\n')));
+		} else {
+			std::istringstream iss(contents);
+			iss >> game;
+		}
+		return true;
+	} catch (Chess::Exception& exception) {
+		std::cerr << "Invalid position: " << exception.what() << std::endl;
+		return false;
+	}
+}
+
+static int find(const Chess::PositionDatabase& db, const std::string& argument, long limit) {
+	Chess::Game game;
+	if (!read_position(argument, game)) {
+		std::cerr << "Cannot read the position " << argument << std::endl;
+		return 1;
+	}
+	Chess::PackedPosition wanted = game.to_packed();
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	std::pair<std::uint64_t, std::uint64_t> range = db.find_key(game.hash());
+
+	// Rows with the same key are the same position unless two keys collide; the
+	// move counters may differ between copies, so compare only the placement and turn
+	std::vector<std::uint64_t> matches;
+	for (std::uint64_t row = range.first; row < range.second; row++) {
+		const Chess::PackedPosition& stored = db.record(row);
+		bool same = true;
+		for (int i = 0; i < 25 && same; i++) {
+			same = stored.bytes[i] == wanted.bytes[i];
+		}
+		if (same) {
+			matches.push_back(row);
+		}
+	}
+	double elapsed = milliseconds_since(start);
+
+	for (std::size_t i = 0; i < matches.size() && static_cast<long>(i) < limit; i++) {
+		print_row(db, matches[i]);
+	}
+	std::cout << matches.size() << " rows found in " << elapsed << " ms" << std::endl;
+	return 0;
+}
+
+static int material(const Chess::PositionDatabase& db, const std::string& signature, long limit) {
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	std::uint64_t index = db.find_signature(signature);
+	std::uint64_t count = index < db.signature_count() ? db.signature_rows(index) : 0;
+	double elapsed = milliseconds_since(start);
+
+	try {
+		for (std::uint64_t n = 0; n < count && static_cast<long>(n) < limit; n++) {
+			print_row(db, db.signature_row(index, n));
+		}
+	} catch (Chess::Exception& exception) {
+		std::cerr << exception.what() << std::endl;
+		return 1;
+	}
+	std::cout << count << " rows found in " << elapsed << " ms" << std::endl;
+	return 0;
+}
+
+static int stats(const Chess::PositionDatabase& db) {
+	std::vector<std::pair<std::uint64_t, std::uint64_t> > by_count;
+	for (std::uint64_t i = 0; i < db.signature_count(); i++) {
+		by_count.push_back(std::make_pair(db.signature_rows(i), i));
+	}
+	std::sort(by_count.rbegin(), by_count.rend());
+
+	std::cout << "Rows: " << db.size() << std::endl;
+	std::cout << "Signatures: " << db.signature_count() << std::endl;
+	for (std::size_t i = 0; i < by_count.size() && i < 20; i++) {
+		std::cout << "\t" << db.signature(by_count[i].second) << "\t" << by_count[i].first << std::endl;
+	}
+	return 0;
+}
+
+int main(int argc, char* argv[]) {
+	if (argc < 3) {
+		show_usage();
+		return 1;
+	}
+	std::string command = argv[1];
+	std::string db_path = argv[2];
+
+	std::vector<std::string> arguments;
+	long limit = 20;
+	for (int i = 3; i < argc; i++) {
+		std::string arg = argv[i];
+		if (arg == "--limit" && i + 1 < argc) {
+			limit = std::atol(argv[++i]);
+		} else {
+			arguments.push_back(arg);
+		}
+	}
+
+	if (command == "build") {
+		if (arguments.empty()) {
+			show_usage();
+			return 1;
+		}
+		return build(db_path, arguments);
+	}
+
+	Chess::PositionDatabase db(db_path.c_str());
+	if (!db.is_open()) {
+		std::cerr << "Cannot open the position database " << db_path << std::endl;
+		return 1;
+	}
+	if (command == "find" && arguments.size() == 1) {
+		return find(db, arguments[0], limit);
+	}
+	if (command == "material" && arguments.size() == 1) {
+		return material(db, arguments[0], limit);
+	}
+	if (command == "stats" && arguments.empty()) {
+		return stats(db);
+	}
+	show_usage();
+	return 1;
+}
@@ -0,0 +1,714 @@
+#include <atomic>
+#include <cctype>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include "Game.h"
+#include "ThreadPool.h"
+
+// Hosts many games in one process. Clients send one JSON object per line, on
+// standard input or over a Unix domain socket, and get one JSON object per line
+// back. Requests for the same game are handled one at a time and in the order
+// they arrived; requests for different games run in parallel on a fixed pool
+// of worker threads. Requests:
+//   {"cmd":"new"[,"game":"<id>"][,"fen":"<fen>"]}      start a game (an id is made up if none is given)
+//   {"cmd":"move","game":"<id>","move":"E2E4"}         make a move, as with the M command
+//   {"cmd":"status","game":"<id>"}                     position, state, material and legal moves
+//   {"cmd":"save","game":"<id>"[,"file":"<name>"]}     the FEN, also written to the file if one is named
+//                                                      and a save directory was given
+//   {"cmd":"close","game":"<id>"}                      forget the game
+// Every reply has "ok" and, if the request had one, the same "id", so replies
+// that arrive out of order across games can be matched up. Failed requests
+// get "ok":false and an "error" message. A game holds at most --max-pending
+// unanswered requests; more are refused until it catches up.
+
+void show_usage() {
+	std::cout << "Usage:" << std::endl;
+	std::cout << "\tchess-server [--threads <n>] [--socket <path>] [--save-dir <directory>] [--max-pending <n>]" << std::endl;
+	std::cout << "\t                serve newline-delimited JSON requests on standard input, or on a" << std::endl;
+	std::cout << "\t                Unix domain socket at <path>, with <n> worker threads; \"save\"" << std::endl;
+	std::cout << "\t                requests may write files only into <directory>, and a game with" << std::endl;
+	std::cout << "\t                --max-pending requests waiting (default 1024) refuses more" << std::endl;
+}
+
+// The fields of a request; all values are kept as text
+struct Request {
+	// The "id" value exactly as it was written, e.g. 17 or "abc", to be echoed back
+	std::string id;
+	std::string cmd;
+	std::string game;
+	std::string move;
+	std::string fen;
+	std::string file;
+};
+
+static void skip_spaces(std::string_view text, std::size_t& at) {
+	while (at < text.size() && std::isspace(static_cast<unsigned char>(text[at]))) {
+		at++;
+	}
+}
+
+// Reads a JSON string starting at the opening quote. Returns false if it is malformed.
+static bool parse_string(std::string_view text, std::size_t& at, std::string& value) {
+	at++;
+	while (at < text.size() && text[at] != '"') {
+		char c = text[at++];
+		if (c != '\\') {
+			value += c;
+			continue;
+		}
+		if (at >= text.size()) {
+			return false;
+		}
+		switch (text[at++]) {
+			case '"': value += '"'; break;
+			case '\\': value += '\\'; break;
+			case '/': value += '/'; break;
+			case 'b': value += '\b'; break;
+			case 'f': value += '\f'; break;
+			case 'n': value += '\n'; break;
+			case 'r': value += '\r'; break;
+			case 't': value += '\t'; break;
+			case 'u': {
+				// Only needed for control characters here, so code points above 0x7F become '?'
+				if (at + 4 > text.size()) {
+					return false;
+				}
+				unsigned long code = std::strtoul(std::string(text.substr(at, 4)).c_str(), nullptr, 16);
+				value += code < 0x80 ? static_cast<char>(code) : '?';
+				at += 4;
+				break;
+			}
+			default: return false;
+		}
+	}
+	if (at >= text.size()) {
+		return false;
+	}
+	at++;
+	return true;
+}
+
+// Returns true if the text is a JSON number, e.g. 17, -0.5 or 1e3
+static bool is_number(std::string_view text) {
+	std::size_t at = 0;
+	auto digits = [&text, &at] {
+		std::size_t start = at;
+		while (at < text.size() && std::isdigit(static_cast<unsigned char>(text[at]))) {
+			at++;
+		}
+		return at > start;
+	};
+
+	if (at < text.size() && text[at] == '-') {
+		at++;
+	}
+	if (at < text.size() && text[at] == '0') {
+		at++;
+	} else if (!digits()) {
+		return false;
+	}
+	if (at < text.size() && text[at] == '.') {
+		at++;
+		if (!digits()) {
+			return false;
+		}
+	}
+	if (at < text.size() && (text[at] == 'e' || text[at] == 'E')) {
+		at++;
+		if (at < text.size() && (text[at] == '+' || text[at] == '-')) {
+			at++;
+		}
+		if (!digits()) {
+			return false;
+		}
+	}
+	return at == text.size();
+}
+
+// Parses a flat JSON object. Unknown keys are ignored; nested values are rejected.
+static bool parse_request(std::string_view text, Request& request) {
+	std::size_t at = 0;
+	skip_spaces(text, at);
+	if (at >= text.size() || text[at] != '{') {
+		return false;
+	}
+	at++;
+	skip_spaces(text, at);
+	if (at < text.size() && text[at] == '}') {
+		return true;
+	}
+
+	while (at < text.size()) {
+		std::string key;
+		skip_spaces(text, at);
+		if (at >= text.size() || text[at] != '"' || !parse_string(text, at, key)) {
+			return false;
+		}
+		skip_spaces(text, at);
+		if (at >= text.size() || text[at] != ':') {
+			return false;
+		}
+		at++;
+		skip_spaces(text, at);
+		if (at >= text.size()) {
+			return false;
+		}
+
+		std::string value;
+		std::size_t value_start = at;
+		if (text[at] == '"') {
+			if (!parse_string(text, at, value)) {
+				return false;
+			}
+		} else if (text[at] == '{' || text[at] == '[') {
+			return false;
+		} else {
+			// A number, true, false or null
+			while (at < text.size() && text[at] != ',' && text[at] != '}' && !std::isspace(static_cast<unsigned char>(text[at]))) {
+				value += text[at++];
+			}
+			if (!is_number(value) && value != "true" && value != "false" && value != "null") {
+				return false;
+			}
+		}
+
+		if (key == "id") {
+			// Echoed back as written, so only a string or a number will do
+			if (text[value_start] != '"' && !is_number(value)) {
+				return false;
+			}
+			request.id = std::string(text.substr(value_start, at - value_start));
+		} else if (key == "cmd") {
+			request.cmd = value;
+		} else if (key == "game") {
+			request.game = value;
+		} else if (key == "move") {
+			request.move = value;
+		} else if (key == "fen") {
+			request.fen = value;
+		} else if (key == "file") {
+			request.file = value;
+		}
+
+		skip_spaces(text, at);
+		if (at < text.size() && text[at] == ',') {
+			at++;
+		} else if (at < text.size() && text[at] == '}') {
+			return true;
+		} else {
+			return false;
+		}
+	}
+	return false;
+}
+
+// Appends a string as a quoted JSON string
+static void append_string(std::string& out, std::string_view value) {
+	out += '"';
+	for (char c : value) {
+		if (c == '"' || c == '\\') {
+			out += '\\';
+			out += c;
+		} else if (static_cast<unsigned char>(c) < 0x20) {
+			char escape[8];
+			std::snprintf(escape, sizeof(escape), "\\u%04x", static_cast<unsigned>(c));
+			out += escape;
+		} else {
+			out += c;
+		}
+	}
+	out += '"';
+}
+
+// Starts a reply, echoing the request's id
+static std::string begin_reply(const Request& request, bool ok) {
+	std::string reply = ok ? "{\"ok\":true" : "{\"ok\":false";
+	if (!request.id.empty()) {
+		reply += ",\"id\":";
+		reply += request.id;
+	}
+	return reply;
+}
+
+static std::string error_reply(const Request& request, std::string_view message) {
+	std::string reply = begin_reply(request, false);
+	reply += ",\"error\":";
+	append_string(reply, message);
+	reply += '}';
+	return reply;
+}
+
+// Where the replies for one client go. Whole lines are written under a lock,
+// so replies from different workers never interleave.
+class Client {
+
+public:
+	// Takes ownership of the descriptor unless it is standard output
+	explicit Client(int fd) : fd(fd) {}
+
+	~Client() {
+		if (fd != STDOUT_FILENO) {
+			close(fd);
+		}
+	}
+
+	Client(const Client&) = delete;
+	Client& operator=(const Client&) = delete;
+
+	int descriptor() const { return fd; }
+
+	void send(std::string line) {
+		line += '\n';
+		std::lock_guard<std::mutex> lock(mutex);
+		const char* data = line.data();
+		std::size_t left = line.size();
+		while (left > 0) {
+			ssize_t written = fd == STDOUT_FILENO ? write(fd, data, left) : ::send(fd, data, left, MSG_NOSIGNAL);
+			if (written < 0 && errno == EINTR) {
+				continue;
+			}
+			if (written <= 0) {
+				// The client went away; its remaining replies are dropped
+				return;
+			}
+			data += written;
+			left -= static_cast<std::size_t>(written);
+		}
+	}
+
+private:
+	const int fd;
+	std::mutex mutex;
+};
+
+// One hosted game and the requests waiting for it
+struct GameSlot {
+	std::mutex mutex;
+	std::deque<std::function<void()> > pending;
+
+	// True while the game is in the server's ready queue or a pool task is
+	// working through pending
+	bool scheduled;
+
+	// Only touched by the task working through pending. A game stops being
+	// open when it is closed or its setup fails, and requests queued behind
+	// that are refused.
+	Chess::Game game;
+	bool open;
+
+	GameSlot() : scheduled(false), open(true) {}
+};
+
+class Server {
+
+public:
+	// Saved games are written into save_dir; with an empty one, "save" only returns the FEN.
+	// A game with max_pending requests waiting refuses more, so a client sending faster
+	// than the game is served cannot make its queue grow without bound.
+	Server(int threads, const std::string& save_dir, std::size_t max_pending)
+		: pool(threads), save_dir(save_dir), max_pending(max_pending), next_game(1) {}
+
+	// Parses one request line and queues it on its game. Replies go to the client.
+	void handle(std::string_view line, const std::shared_ptr<Client>& client) {
+		Request request;
+		if (!parse_request(line, request)) {
+			client->send(error_reply(request, "invalid request"));
+			return;
+		}
+
+		if (request.cmd == "new") {
+			start_game(request, client);
+			return;
+		}
+		if (request.cmd != "move" && request.cmd != "status" && request.cmd != "save" && request.cmd != "close") {
+			client->send(error_reply(request, "unknown command"));
+			return;
+		}
+
+		std::shared_ptr<GameSlot> slot = find(request.game);
+		if (!slot) {
+			client->send(error_reply(request, "no such game"));
+			return;
+		}
+		if (!enqueue(slot, [this, slot, request, client] { client->send(run(*slot, request)); })) {
+			client->send(error_reply(request, "too many requests waiting for the game"));
+			return;
+		}
+		if (request.cmd == "close") {
+			forget(request.game, slot);
+		}
+	}
+
+	// Blocks until every queued request has been answered
+	void wait() { pool.wait(); }
+
+private:
+	// Requests one pool task handles for a game before letting other games have the thread
+	static const int BATCH = 16;
+
+	Chess::ThreadPool pool;
+	const std::string save_dir;
+	const std::size_t max_pending;
+
+	// Games with requests waiting, in the order they became ready. The pool
+	// runs its own queues newest first, so every pool task takes whichever game
+	// is at the front here instead of being tied to one game.
+	std::mutex ready_mutex;
+	std::deque<std::shared_ptr<GameSlot> > ready;
+
+	std::mutex games_mutex;
+	std::unordered_map<std::string, std::shared_ptr<GameSlot> > games;
+	std::atomic<unsigned long long> next_game;
+
+	std::shared_ptr<GameSlot> find(const std::string& id) {
+		std::lock_guard<std::mutex> lock(games_mutex);
+		std::unordered_map<std::string, std::shared_ptr<GameSlot> >::const_iterator it = games.find(id);
+		return it == games.end() ? std::shared_ptr<GameSlot>() : it->second;
+	}
+
+	// Removes the game, unless the id has meanwhile been given to a new one
+	void forget(const std::string& id, const std::shared_ptr<GameSlot>& slot) {
+		std::lock_guard<std::mutex> lock(games_mutex);
+		std::unordered_map<std::string, std::shared_ptr<GameSlot> >::iterator it = games.find(id);
+		if (it != games.end() && it->second == slot) {
+			games.erase(it);
+		}
+	}
+
+	void start_game(Request request, const std::shared_ptr<Client>& client) {
+		std::shared_ptr<GameSlot> slot(new GameSlot());
+		{
+			std::lock_guard<std::mutex> lock(games_mutex);
+			if (request.game.empty()) {
+				do {
+					request.game = "g" + std::to_string(next_game++);
+				} while (games.find(request.game) != games.end());
+			}
+			if (!games.emplace(request.game, slot).second) {
+				client->send(error_reply(request, "game already exists"));
+				return;
+			}
+		}
+
+		// Later requests for the game queue up behind the setup, so they may be sent at once
+		const bool queued = enqueue(slot, [this, slot, request, client] {
+			if (!request.fen.empty()) {
+				try {
+					slot->game.load_fen(request.fen);
+				} catch (const Chess::Exception& exception) {
+					slot->open = false;
+					forget(request.game, slot);
+					client->send(error_reply(request, exception.what()));
+					return;
+				}
+			}
+			std::string reply = begin_reply(request, true);
+			reply += ",\"game\":";
+			append_string(reply, request.game);
+			reply += ",\"fen\":";
+			append_string(reply, slot->game.to_fen());
+			reply += '}';
+			client->send(reply);
+		});
+		if (!queued) {
+			forget(request.game, slot);
+			client->send(error_reply(request, "too many requests waiting for the game"));
+		}
+	}
+
+	// Adds a task to the game's queue, making the game ready if it was idle.
+	// Returns false, dropping the task, if the queue is full.
+	bool enqueue(const std::shared_ptr<GameSlot>& slot, std::function<void()> task) {
+		bool start = false;
+		{
+			std::lock_guard<std::mutex> lock(slot->mutex);
+			if (slot->pending.size() >= max_pending) {
+				return false;
+			}
+			slot->pending.push_back(std::move(task));
+			if (!slot->scheduled) {
+				slot->scheduled = start = true;
+			}
+		}
+		if (start) {
+			make_ready(slot);
+		}
+		return true;
+	}
+
+	// Puts the game at the back of the ready queue, with one pool task to serve it
+	void make_ready(const std::shared_ptr<GameSlot>& slot) {
+		{
+			std::lock_guard<std::mutex> lock(ready_mutex);
+			ready.push_back(slot);
+		}
+		pool.submit([this] { drain_next(); });
+	}
+
+	// Runs a batch of the queued tasks of the game at the front of the ready queue
+	void drain_next() {
+		std::shared_ptr<GameSlot> slot;
+		{
+			std::lock_guard<std::mutex> lock(ready_mutex);
+			slot = ready.front();
+			ready.pop_front();
+		}
+
+		for (int done = 0; done < BATCH; done++) {
+			std::function<void()> task;
+			{
+				std::lock_guard<std::mutex> lock(slot->mutex);
+				if (slot->pending.empty()) {
+					slot->scheduled = false;
+					return;
+				}
+				task = std::move(slot->pending.front());
+				slot->pending.pop_front();
+			}
+			task();
+		}
+
+		// More are waiting: go behind the games that became ready meanwhile
+		make_ready(slot);
+	}
+
+	static const char* state_name(const Chess::GameStatus& status) {
+		if (status.mate) {
+			return "checkmate";
+		}
+		if (status.stalemate) {
+			return "stalemate";
+		}
+		return status.check ? "check" : "playing";
+	}
+
+	// Adds the player to move and the state of the game to a reply
+	static void append_state(std::string& reply, const Chess::Game& game) {
+		const Chess::GameStatus& status = game.status();
+		reply += game.turn_white() ? ",\"turn\":\"white\",\"state\":\"" : ",\"turn\":\"black\",\"state\":\"";
+		reply += state_name(status);
+		reply += '"';
+	}
+
+	// Handles a request for an existing game, on the thread that owns it for now
+	std::string run(GameSlot& slot, const Request& request) const {
+		Chess::Game& game = slot.game;
+		if (!slot.open) {
+			return error_reply(request, "no such game");
+		}
+
+		if (request.cmd == "move") {
+			std::string move = request.move;
+			for (char& c : move) {
+				c = static_cast<char>(std::toupper(static_cast<unsigned char>(c)));
+			}
+			// A trailing Q names the promotion piece, which is always a queen here
+			if (move.size() == 5 && move[4] == 'Q') {
+				move.pop_back();
+			}
+			if (move.size() != 4) {
+				return error_reply(request, "move must be four characters");
+			}
+			if (game.status().mate || game.status().stalemate) {
+				return error_reply(request, "game is over");
+			}
+			try {
+				game.make_move(Chess::Position(move[0], move[1]), Chess::Position(move[2], move[3]));
+			} catch (const Chess::Exception& exception) {
+				return error_reply(request, exception.what());
+			}
+			std::string reply = begin_reply(request, true);
+			reply += ",\"game\":";
+			append_string(reply, request.game);
+			reply += ",\"move\":";
+			append_string(reply, move);
+			append_state(reply, game);
+			reply += '}';
+			return reply;
+		}
+
+		if (request.cmd == "status") {
+			const Chess::GameStatus& status = game.status();
+			std::string reply = begin_reply(request, true);
+			reply += ",\"game\":";
+			append_string(reply, request.game);
+			append_state(reply, game);
+			reply += ",\"fen\":";
+			append_string(reply, game.to_fen());
+			reply += ",\"material\":{\"white\":";
+			reply += std::to_string(game.turn_white() ? status.material : status.opponent_material);
+			reply += ",\"black\":";
+			reply += std::to_string(game.turn_white() ? status.opponent_material : status.material);
+			reply += "},\"legal_moves\":[";
+			for (int i = 0; i < status.legal_moves.size(); i++) {
+				if (i > 0) {
+					reply += ',';
+				}
+				append_string(reply, status.legal_moves[i].name());
+			}
+			reply += "]}";
+			return reply;
+		}
+
+		if (request.cmd == "save") {
+			std::string fen = game.to_fen();
+			if (!request.file.empty()) {
+				// A plain file name only, so clients cannot write outside the directory
+				if (save_dir.empty()) {
+					return error_reply(request, "saving to files is not enabled");
+				}
+				if (request.file.find('/') != std::string::npos || request.file == "." || request.file == "..") {
+					return error_reply(request, "file must be a name without a directory");
+				}
+				std::ofstream ofs(save_dir + "/" + request.file);
+				ofs << fen << std::endl;
+				if (!ofs) {
+					return error_reply(request, "cannot write " + request.file);
+				}
+			}
+			std::string reply = begin_reply(request, true);
+			reply += ",\"game\":";
+			append_string(reply, request.game);
+			reply += ",\"fen\":";
+			append_string(reply, fen);
+			reply += '}';
+			return reply;
+		}
+
+		// close: the game was already taken out of the table
+		slot.open = false;
+		std::string reply = begin_reply(request, true);
+		reply += ",\"game\":";
+		append_string(reply, request.game);
+		reply += '}';
+		return reply;
+	}
+};
+
+// Reads request lines from a descriptor until it is closed, without the
+// per-character cost of iostreams
+static void read_requests(Server& server, int fd, const std::shared_ptr<Client>& client) {
+	std::string buffer;
+	char chunk[65536];
+	for (;;) {
+		ssize_t got = read(fd, chunk, sizeof(chunk));
+		if (got < 0 && errno == EINTR) {
+			continue;
+		}
+		if (got <= 0) {
+			break;
+		}
+		buffer.append(chunk, static_cast<std::size_t>(got));
+
+		std::size_t start = 0;
+		for (std::size_t end = buffer.find('\n'); end != std::string::npos; end = buffer.find('\n', start)) {
+			std::string_view line(buffer.data() + start, end - start);
+			if (line.find_first_not_of(" \t\r") != std::string_view::npos) {
+				server.handle(line, client);
+			}
+			start = end + 1;
+		}
+		buffer.erase(0, start);
+	}
+	if (buffer.find_first_not_of(" \t\r") != std::string::npos) {
+		server.handle(buffer, client);
+	}
+}
+
+// Accepts connections forever, with one reader thread per connection
+static int serve_socket(Server& server, const std::string& path) {
+	int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+	sockaddr_un address;
+	std::memset(&address, 0, sizeof(address));
+	address.sun_family = AF_UNIX;
+	if (listener < 0 || path.size() >= sizeof(address.sun_path)) {
+		std::cerr << "Cannot create socket " << path << std::endl;
+		return 1;
+	}
+	std::strcpy(address.sun_path, path.c_str());
+
+	// A socket left behind by an earlier run is replaced, but nothing else is
+	struct stat existing;
+	if (lstat(path.c_str(), &existing) == 0) {
+		if (!S_ISSOCK(existing.st_mode)) {
+			std::cerr << "Cannot listen on " << path << ": exists and is not a socket" << std::endl;
+			close(listener);
+			return 1;
+		}
+		unlink(path.c_str());
+	}
+	if (bind(listener, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0 || listen(listener, 64) < 0) {
+		std::cerr << "Cannot listen on " << path << ": " << std::strerror(errno) << std::endl;
+		close(listener);
+		return 1;
+	}
+
+	for (;;) {
+		int fd = accept(listener, nullptr, nullptr);
+		if (fd < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			std::cerr << "accept failed: " << std::strerror(errno) << std::endl;
+			close(listener);
+			return 1;
+		}
+		std::shared_ptr<Client> client(new Client(fd));
+		std::thread([&server, client] { read_requests(server, client->descriptor(), client); }).detach();
+	}
+}
+
+int main(int argc, char* argv[]) {
+	int threads = static_cast<int>(std::thread::hardware_concurrency());
+	std::string socket_path;
+	std::string save_dir;
+	long max_pending = 1024;
+
+	for (int i = 1; i < argc; i++) {
+		std::string arg = argv[i];
+		if (arg == "--threads" && i + 1 < argc) {
+			threads = std::atoi(argv[++i]);
+		} else if (arg == "--socket" && i + 1 < argc) {
+			socket_path = argv[++i];
+		} else if (arg == "--save-dir" && i + 1 < argc) {
+			save_dir = argv[++i];
+		} else if (arg == "--max-pending" && i + 1 < argc) {
+			max_pending = std::atol(argv[++i]);
+		} else {
+			show_usage();
+			return 1;
+		}
+	}
+	if (threads < 1) {
+		threads = 1;
+	}
+	if (max_pending < 1) {
+		max_pending = 1;
+	}
+
+	Server server(threads, save_dir, static_cast<std::size_t>(max_pending));
+	if (!socket_path.empty()) {
+		return serve_socket(server, socket_path);
+	}
+
+	std::shared_ptr<Client> output(new Client(STDOUT_FILENO));
+	read_requests(server, STDIN_FILENO, output);
+	server.wait();
+	return 0;
+}
@@ -0,0 +1,512 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+#include "Attacks.h"
+#include "Tablebase.h"
+#include "ThreadPool.h"
+
+// Builds distance-to-mate endgame tablebases by retrograde analysis.
+//
+// A first pass over every position of the material set finds the illegal
+// positions, the mates and stalemates, and counts each position's moves. Moves
+// that capture or promote leave the set; their outcome is read from the smaller
+// tables, which are built first. Then, one ply at a time, the positions decided
+// at the previous ply are taken back a move: a position from which the player to
+// move can reach a lost position is won, and a position whose moves all reach won
+// positions is lost. Each pass is split over a thread pool.
+
+// Per-position state while building. Values below DRAW are plies to mate: even
+// for a loss of the player to move, odd for a win.
+static const std::uint8_t UNKNOWN = 255;
+static const std::uint8_t INVALID = 254;
+static const std::uint8_t DRAW = 253;
+
+// No result from moves that leave the set
+static const std::uint8_t NONE = 255;
+
+// A move that leaves the set reaches a draw, so the position cannot be lost
+static const std::uint8_t CANNOT_LOSE = 254;
+
+// Longest mate, in plies, that can be stored
+static const int MAX_PLIES = 250;
+
+// Positions handled by one pool task
+static const std::uint32_t CHUNK = 1 << 14;
+
+void show_usage() {
+	std::cout << "Usage:" << std::endl;
+	std::cout << "\ttbgen [--threads <n>] [--dir <directory>] <material>..." << std::endl;
+	std::cout << "\t                build the tables for each material set, e.g. KQK KRK KPK KBNK KQKR," << std::endl;
+	std::cout << "\t                and the smaller ones they depend on, writing <material>.ctb files" << std::endl;
+	std::cout << "\t                to <directory> (default .), on <n> threads (default one per core)" << std::endl;
+}
+
+static Chess::Bitboard piece_attacks(Chess::PieceType type, bool white, int square, Chess::Bitboard occupied) {
+	switch (type) {
+		case Chess::PAWN: return Chess::pawn_attacks(white, square);
+		case Chess::KNIGHT: return Chess::knight_attacks(square);
+		case Chess::BISHOP: return Chess::bishop_attacks(square, occupied);
+		case Chess::ROOK: return Chess::rook_attacks(square, occupied);
+		case Chess::QUEEN: return Chess::queen_attacks(square, occupied);
+		case Chess::KING: return Chess::king_attacks(square);
+		default: return 0;
+	}
+}
+
+static Chess::Bitboard occupancy(const Chess::TablebasePosition& position) {
+	Chess::Bitboard occupied = 0;
+	for (int i = 0; i < position.count; i++) {
+		occupied |= Chess::square_bb(position.squares[i]);
+	}
+	return occupied;
+}
+
+// Returns true if the king of the given color is attacked by the other side
+static bool in_check(const Chess::TablebasePosition& position, bool white) {
+	Chess::Bitboard occupied = occupancy(position);
+	int king = -1;
+	for (int i = 0; i < position.count; i++) {
+		if (position.types[i] == Chess::KING && position.whites[i] == white) {
+			king = position.squares[i];
+		}
+	}
+	for (int i = 0; i < position.count; i++) {
+		if (position.whites[i] != white
+		    && (piece_attacks(position.types[i], position.whites[i], position.squares[i], occupied) & Chess::square_bb(king))) {
+			return true;
+		}
+	}
+	return false;
+}
+
+// Builds the table of one material set
+class Generator {
+
+public:
+	Generator(const std::string& material, const Chess::Tablebases& smaller, Chess::ThreadPool& pool)
+		: layout(material), smaller(smaller), pool(pool), size(layout.size()),
+		  state(new std::atomic<std::uint8_t>[size]), remaining(new std::atomic<std::uint8_t>[size]),
+		  conversion_win(new std::uint8_t[size]), conversion_loss(new std::uint8_t[size]), failed(false) {}
+
+	// Returns the finished table, in the stored byte format
+	std::vector<std::uint8_t> run() {
+		int longest_conversion = 0;
+		std::atomic<int> conversion_level(0);
+		for_each_chunk([&](std::uint32_t begin, std::uint32_t end) {
+			int highest = 0;
+			for (std::uint32_t index = begin; index < end; index++) {
+				highest = std::max(highest, initialize(index));
+			}
+			int current = conversion_level.load();
+			while (highest > current && !conversion_level.compare_exchange_weak(current, highest)) {
+			}
+		});
+		longest_conversion = conversion_level.load();
+		if (failed) {
+			throw Chess::Exception("a smaller table needed by " + layout.material() + " is missing");
+		}
+
+		for (int level = 1; level <= MAX_PLIES; level++) {
+			std::atomic<bool> changed(false);
+
+			// Positions decided by the moves that leave the set
+			for_each_chunk([&](std::uint32_t begin, std::uint32_t end) {
+				for (std::uint32_t index = begin; index < end; index++) {
+					if (state[index] == UNKNOWN && settle_by_conversion(index, level)) {
+						changed = true;
+					}
+				}
+			});
+
+			// Positions one move before those decided at the previous ply
+			for_each_chunk([&](std::uint32_t begin, std::uint32_t end) {
+				for (std::uint32_t index = begin; index < end; index++) {
+					if (state[index] == level - 1 && retract(index, level)) {
+						changed = true;
+					}
+				}
+			});
+
+			if (!changed && level > longest_conversion) {
+				break;
+			}
+			if (level == MAX_PLIES) {
+				throw Chess::Exception("mate in " + layout.material() + " is too long to store");
+			}
+		}
+
+		std::vector<std::uint8_t> values(size);
+		for (std::uint32_t index = 0; index < size; index++) {
+			std::uint8_t value = state[index];
+			if (value == INVALID) {
+				values[index] = Chess::TB_INVALID;
+			} else if (value == UNKNOWN || value == DRAW) {
+				values[index] = Chess::TB_DRAW;
+			} else if (value % 2 == 1) {
+				values[index] = static_cast<std::uint8_t>((value + 1) / 2);
+			} else {
+				values[index] = static_cast<std::uint8_t>(Chess::TB_LOSS + value / 2);
+			}
+		}
+		return values;
+	}
+
+private:
+	template <typename Function>
+	void for_each_chunk(Function function) {
+		for (std::uint32_t begin = 0; begin < size; begin += CHUNK) {
+			std::uint32_t end = std::min(size, begin + CHUNK);
+			pool.submit([function, begin, end] { function(begin, end); });
+		}
+		pool.wait();
+	}
+
+	// Classifies one position and counts its moves that stay in the set. Returns
+	// the highest ply at which a move leaving the set decides it, or 0.
+	int initialize(std::uint32_t index) {
+		state[index] = INVALID;
+		remaining[index] = 0;
+		conversion_win[index] = NONE;
+		conversion_loss[index] = NONE;
+
+		Chess::TablebasePosition position;
+		if (!layout.decode(index, position) || in_check(position, !position.white_to_move)) {
+			return 0;
+		}
+
+		const bool white = position.white_to_move;
+		const Chess::Bitboard occupied = occupancy(position);
+		Chess::Bitboard own = 0;
+		for (int i = 0; i < position.count; i++) {
+			if (position.whites[i] == white) {
+				own |= Chess::square_bb(position.squares[i]);
+			}
+		}
+
+		int moves = 0;
+		int in_set = 0;
+		int best_win = NONE;
+		int worst_loss = -1;
+		bool draw = false;
+
+		for (int i = 0; i < position.count; i++) {
+			if (position.whites[i] != white) {
+				continue;
+			}
+			const int from = position.squares[i];
+			Chess::Bitboard targets;
+			if (position.types[i] == Chess::PAWN) {
+				const int step = white ? 8 : -8;
+				targets = Chess::pawn_attacks(white, from) & occupied & ~own;
+				if (!(occupied & Chess::square_bb(from + step))) {
+					targets |= Chess::square_bb(from + step);
+					const int start_row = white ? 1 : 6;
+					if (from / 8 == start_row && !(occupied & Chess::square_bb(from + 2 * step))) {
+						targets |= Chess::square_bb(from + 2 * step);
+					}
+				}
+			} else {
+				targets = piece_attacks(position.types[i], white, from, occupied) & ~own;
+			}
+
+			while (targets) {
+				const int to = Chess::pop_lsb(targets);
+				Chess::TablebasePosition child = position;
+				child.white_to_move = !white;
+				child.squares[i] = to;
+				bool leaves_set = false;
+
+				if (occupied & Chess::square_bb(to)) {
+					for (int j = 0; j < child.count; j++) {
+						if (j != i && child.squares[j] == to) {
+							child.count--;
+							child.types[j] = child.types[child.count];
+							child.whites[j] = child.whites[child.count];
+							child.squares[j] = child.squares[child.count];
+							break;
+						}
+					}
+					leaves_set = true;
+				}
+				if (position.types[i] == Chess::PAWN && (to / 8 == 0 || to / 8 == 7)) {
+					// Find the pawn again, since a capture may have moved it in the list
+					for (int j = 0; j < child.count; j++) {
+						if (child.squares[j] == to) {
+							child.types[j] = Chess::QUEEN;
+						}
+					}
+					leaves_set = true;
+				}
+
+				if (in_check(child, white)) {
+					continue;
+				}
+				moves++;
+
+				if (!leaves_set) {
+					in_set++;
+					continue;
+				}
+
+				// Only kings left, or a table of fewer pieces
+				std::uint8_t value = child.count == 2 ? Chess::TB_DRAW : smaller.value(child);
+				if (value == Chess::TB_INVALID) {
+					failed = true;
+					continue;
+				}
+				Chess::TablebaseResult result = Chess::decode_tablebase_value(value);
+				if (result.outcome < 0) {
+					best_win = std::min(best_win, result.plies + 1);
+				} else if (result.outcome > 0) {
+					worst_loss = std::max(worst_loss, result.plies + 1);
+				} else {
+					draw = true;
+				}
+			}
+		}
+
+		if (moves == 0) {
+			state[index] = in_check(position, white) ? 0 : DRAW;
+			return 0;
+		}
+
+		state[index] = UNKNOWN;
+		remaining[index] = static_cast<std::uint8_t>(in_set);
+		conversion_win[index] = static_cast<std::uint8_t>(best_win);
+		conversion_loss[index] = draw ? CANNOT_LOSE : (worst_loss >= 0 ? static_cast<std::uint8_t>(worst_loss) : NONE);
+
+		int highest = 0;
+		if (best_win != NONE) {
+			highest = best_win;
+		} else if (!draw && worst_loss >= 0) {
+			highest = worst_loss;
+		}
+		return highest;
+	}
+
+	// Decides a position at the given ply if a move leaving the set wins there, or
+	// if every move has been shown to lose and the slowest loss leaves the set there
+	bool settle_by_conversion(std::uint32_t index, int level) {
+		if (conversion_win[index] == level) {
+			return settle(index, level);
+		}
+		if (conversion_win[index] == NONE && remaining[index] == 0 && conversion_loss[index] == level) {
+			return settle(index, level);
+		}
+		return false;
+	}
+
+	bool settle(std::uint32_t index, int level) {
+		std::uint8_t expected = UNKNOWN;
+		return state[index].compare_exchange_strong(expected, static_cast<std::uint8_t>(level));
+	}
+
+	// Takes back every move that could have led to a position decided at the
+	// previous ply, and updates the positions before it
+	bool retract(std::uint32_t index, int level) {
+		Chess::TablebasePosition position;
+		layout.decode(index, position);
+		const bool lost = (level - 1) % 2 == 0;
+		const bool mover = !position.white_to_move;
+		const Chess::Bitboard occupied = occupancy(position);
+		bool changed = false;
+
+		for (int i = 0; i < position.count; i++) {
+			if (position.whites[i] != mover) {
+				continue;
+			}
+			const int to = position.squares[i];
+			Chess::Bitboard origins;
+			if (position.types[i] == Chess::PAWN) {
+				const int step = mover ? -8 : 8;
+				origins = 0;
+				const int back = to + step;
+				if (back / 8 != 0 && back / 8 != 7 && !(occupied & Chess::square_bb(back))) {
+					origins |= Chess::square_bb(back);
+					const int double_row = mover ? 3 : 4;
+					if (to / 8 == double_row && !(occupied & Chess::square_bb(back + step))) {
+						origins |= Chess::square_bb(back + step);
+					}
+				}
+			} else {
+				origins = piece_attacks(position.types[i], mover, to, occupied) & ~occupied;
+			}
+
+			while (origins) {
+				Chess::TablebasePosition before = position;
+				before.squares[i] = Chess::pop_lsb(origins);
+				before.white_to_move = mover;
+				const std::uint32_t previous = layout.index(before);
+				if (state[previous] != UNKNOWN) {
+					continue;
+				}
+
+				if (lost) {
+					// The player to move there can reach a lost position
+					changed |= settle(previous, level);
+				} else if (--remaining[previous] == 0 && conversion_win[previous] == NONE) {
+					// Every move there reaches a won position
+					const std::uint8_t exit = conversion_loss[previous];
+					if (exit == NONE || exit <= level) {
+						changed |= settle(previous, level);
+					}
+				}
+			}
+		}
+		return changed;
+	}
+
+	Chess::TablebaseLayout layout;
+	const Chess::Tablebases& smaller;
+	Chess::ThreadPool& pool;
+	const std::uint32_t size;
+	std::unique_ptr<std::atomic<std::uint8_t>[]> state;
+	std::unique_ptr<std::atomic<std::uint8_t>[]> remaining;
+	std::unique_ptr<std::uint8_t[]> conversion_win;
+	std::unique_ptr<std::uint8_t[]> conversion_loss;
+	std::atomic<bool> failed;
+};
+
+// Adds the sets reached by one capture or promotion, then the set itself, so
+// that every table is built after the ones it depends on
+static void add_with_dependencies(const std::string& material, std::vector<std::string>& order) {
+	if (std::find(order.begin(), order.end(), material) != order.end()) {
+		return;
+	}
+	std::string::size_type split = material.find('K', 1);
+	for (std::string::size_type i = 1; i < material.size(); i++) {
+		if (i == split) {
+			continue;
+		}
+		std::vector<std::string> children;
+		children.push_back(material.substr(0, i) + material.substr(i + 1));
+		if (material[i] == 'P') {
+			std::string promoted = material;
+			promoted[i] = 'Q';
+			// Keep the side's pieces in name order
+			std::string::size_type begin = i < split ? 1 : split + 1;
+			std::string::size_type end = i < split ? split : promoted.size();
+			std::sort(promoted.begin() + begin, promoted.begin() + end, [](char a, char b) {
+				return std::string("QRBNP").find(a) < std::string("QRBNP").find(b);
+			});
+			children.push_back(promoted);
+		}
+		for (const std::string& child : children) {
+			bool flipped = false;
+			std::string canonical = Chess::canonical_material(child, flipped);
+			if (canonical.size() > 2) {
+				add_with_dependencies(canonical, order);
+			}
+		}
+	}
+	order.push_back(material);
+}
+
+static bool write_table(const std::string& path, const std::string& material, const std::vector<std::uint8_t>& values) {
+	std::ofstream ofs(path, std::ios::binary);
+	char header[Chess::TABLEBASE_HEADER_SIZE] = { 'C', 'H', 'T', 'B' };
+	for (std::string::size_type i = 0; i < material.size(); i++) {
+		header[4 + i] = material[i];
+	}
+	std::uint32_t size = static_cast<std::uint32_t>(values.size());
+	for (int i = 0; i < 4; i++) {
+		header[12 + i] = static_cast<char>((size >> (8 * i)) & 0xFF);
+	}
+	ofs.write(header, sizeof(header));
+	ofs.write(reinterpret_cast<const char*>(values.data()), static_cast<std::streamsize>(values.size()));
+	return static_cast<bool>(ofs);
+}
+
+int main(int argc, char* argv[]) {
+	int threads = 0;
+	std::string directory = ".";
+	std::vector<std::string> requested;
+
+	for (int i = 1; i < argc; i++) {
+		std::string arg = argv[i];
+		if (arg == "--threads" && i + 1 < argc) {
+			threads = std::atoi(argv[++i]);
+		} else if (arg == "--dir" && i + 1 < argc) {
+			directory = argv[++i];
+		} else if (arg[0] != '-') {
+			bool flipped = false;
+			std::string canonical = Chess::canonical_material(arg, flipped);
+			if (!Chess::is_valid_material(arg) || canonical.size() <= 2) {
+				std::cerr << "Not a material set of 3 to " << Chess::TABLEBASE_MAX_PIECES << " pieces: " << arg << std::endl;
+				return 1;
+			}
+			requested.push_back(canonical);
+		} else {
+			show_usage();
+			return 1;
+		}
+	}
+	if (requested.empty()) {
+		show_usage();
+		return 1;
+	}
+
+	std::vector<std::string> order;
+	for (const std::string& material : requested) {
+		add_with_dependencies(material, order);
+	}
+
+	Chess::ThreadPool pool(threads);
+	Chess::Tablebases tables;
+	std::map<std::string, std::vector<std::uint8_t> > built;
+
+	for (const std::string& material : order) {
+		const std::string path = directory + "/" + material + ".ctb";
+		if (tables.load_file(path)) {
+			std::cout << material << ": already in " << path << std::endl;
+			continue;
+		}
+
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		std::vector<std::uint8_t>& values = built[material];
+		try {
+			Generator generator(material, tables, pool);
+			values = generator.run();
+		} catch (Chess::Exception& exception) {
+			std::cerr << "Cannot build " << material << ": " << exception.what() << std::endl;
+			return 1;
+		}
+		tables.add(material, values.data());
+		double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+		// Summary for white to move, which is the stronger side
+		unsigned long long wins = 0, losses = 0, draws = 0;
+		int longest = 0;
+		for (std::uint32_t index = 0; index < values.size() / 2; index++) {
+			std::uint8_t value = values[index];
+			if (value == Chess::TB_INVALID) {
+				continue;
+			}
+			if (value == Chess::TB_DRAW) {
+				draws++;
+			} else if (value < Chess::TB_LOSS) {
+				wins++;
+				longest = std::max(longest, static_cast<int>(value));
+			} else {
+				losses++;
+			}
+		}
+
+		if (!write_table(path, material, values)) {
+			std::cerr << "Cannot write " << path << std::endl;
+			return 1;
+		}
+		std::cout << material << ": " << values.size() << " positions, white to move wins " << wins << ", draws " << draws
+		          << ", loses " << losses << ", longest mate " << longest << " moves, "
+		          << static_cast<long long>(seconds * 1000) << " ms, written to " << path << std::endl;
+	}
+	return 0;
+}
@@ -0,0 +1,43 @@
+#include <cstdint>
+#include <iostream>
+#include "Game.h"
+#include "OpeningBook.h"
+
+// Checks OpeningBook::key against the example keys of the Polyglot
+// specification. Positions whose published key includes an en passant number
+// are left out, since en passant keys are never used here.
+
+struct KeyExample {
+	const char* fen;
+	std::uint64_t key;
+};
+
+static const KeyExample EXAMPLES[] = {
+	{ "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1", 0x463B96181691FC9CULL },
+	{ "rnbqkbnr/pppppppp/8/8/4P3/8/PPPP1PPP/RNBQKBNR b KQkq e3 0 1", 0x823C9B50FD114196ULL },
+	{ "rnbqkbnr/ppp1pppp/8/3p4/4P3/8/PPPP1PPP/RNBQKBNR w KQkq d6 0 2", 0x0756B94461C50FB0ULL },
+	{ "rnbqkbnr/ppp1pppp/8/3pP3/8/8/PPPP1PPP/RNBQKBNR b KQkq - 0 2", 0x662FAFB965DB29D4ULL },
+	{ "rnbqkbnr/ppp1p1pp/8/3pPp2/8/8/PPPPKPPP/RNBQ1BNR b kq - 0 3", 0x652A607CA3F242C1ULL },
+	{ "rnbq1bnr/ppp1pkpp/8/3pPp2/8/8/PPPPKPPP/RNBQ1BNR w - - 0 4", 0x00FDD303C946BDD9ULL },
+	{ "rnbqkbnr/p1pppppp/8/8/P6P/R1p5/1P1PPPP1/1NBQKBNR b Kkq - 0 4", 0x5C3F9B829B279560ULL },
+};
+
+int main() {
+	Chess::OpeningBook book;
+	Chess::Game game;
+	int failures = 0;
+	for (const KeyExample& example : EXAMPLES) {
+		game.load_fen(example.fen);
+		std::uint64_t key = book.key(game);
+		if (key != example.key) {
+			std::cout << "Wrong key for " << example.fen << ": " << std::hex << key
+				<< ", expected " << example.key << std::dec << std::endl;
+			failures++;
+		}
+	}
+	if (failures != 0) {
+		return 1;
+	}
+	std::cout << "All Polyglot keys match" << std::endl;
+	return 0;
+}
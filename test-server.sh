@@ -0,0 +1,47 @@
+#!/bin/sh
+# Checks that one busy game does not hold up the others in chess-server. With
+# one worker thread, a status request for game "b" sent shortly after 20000
+# requests for game "a" must be answered long before the last of them. Then
+# checks that a game with --max-pending requests waiting refuses more.
+
+SERVER=${SERVER:-./chess-server}
+REQUESTS=20000
+OUTPUT=$(mktemp)
+trap 'rm -f "$OUTPUT"' EXIT
+
+{
+	echo '{"cmd":"new","game":"a"}'
+	echo '{"cmd":"new","game":"b"}'
+	sleep 0.05
+	yes '{"cmd":"status","game":"a"}' | head -n $REQUESTS
+	sleep 0.01
+	echo '{"cmd":"status","game":"b","id":"b"}'
+} | "$SERVER" --threads 1 --max-pending $REQUESTS > "$OUTPUT"
+
+LINES=$(wc -l < "$OUTPUT")
+LINE=$(grep -n '"id":"b"' "$OUTPUT" | cut -d: -f1)
+if [ "$LINES" -ne $((REQUESTS + 3)) ] || [ -z "$LINE" ]; then
+	echo "FAIL: expected $((REQUESTS + 3)) replies including game b's, got $LINES"
+	exit 1
+fi
+if [ "$LINE" -gt $((REQUESTS - 1000)) ]; then
+	echo "FAIL: game b was answered at reply $LINE of $LINES, behind nearly all of game a"
+	exit 1
+fi
+echo "PASS: game b was answered at reply $LINE of $LINES"
+
+# With room for only 10 waiting requests, most of a burst is refused, but every
+# request still gets exactly one reply
+{
+	echo '{"cmd":"new","game":"a"}'
+	sleep 0.05
+	yes '{"cmd":"status","game":"a"}' | head -n 2000
+} | "$SERVER" --threads 1 --max-pending 10 > "$OUTPUT"
+
+LINES=$(wc -l < "$OUTPUT")
+REFUSED=$(grep -c '"too many requests waiting for the game"' "$OUTPUT")
+if [ "$LINES" -ne 2001 ] || [ "$REFUSED" -eq 0 ]; then
+	echo "FAIL: expected 2001 replies with some refused, got $LINES with $REFUSED refused"
+	exit 1
+fi
+echo "PASS: $REFUSED of 2000 requests were refused with 10 allowed to wait"
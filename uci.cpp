@@ -0,0 +1,242 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include "Game.h"
+#include "Search.h"
+
+// Speaks the UCI protocol on stdin and stdout, so the engine can be driven by
+// chess GUIs and match runners. Searches run on a background thread while
+// commands keep being read, so "stop" and "isready" are answered at once.
+//
+// Moves are written the UCI way, in lower case with a trailing 'q' for
+// promotions, e.g. "e2e4" and "e7e8q". Since pawns here always promote to a
+// queen, a promotion to any other piece is rejected as an illegal move.
+
+static const char* const START_FEN = "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w - - 0 1";
+
+// Lines can be written by the search thread and the command loop at once
+static std::mutex output_mutex;
+
+static void send(const std::string& line) {
+	std::lock_guard<std::mutex> lock(output_mutex);
+	std::cout << line << std::endl;
+}
+
+// Reports one completed iteration in the "info" format
+static std::string info_line(const Chess::SearchResult& result) {
+	std::ostringstream line;
+	line << "info depth " << result.depth;
+	if (Chess::is_mate_score(result.score)) {
+		// UCI counts mates in moves, negative when the engine is being mated
+		int plies = Chess::MATE_SCORE - std::abs(result.score);
+		int moves = (plies + 1) / 2;
+		line << " score mate " << (result.score > 0 ? moves : -moves);
+	} else {
+		line << " score cp " << result.score;
+	}
+	line << " nodes " << result.nodes << " nps " << result.nps()
+	     << " time " << static_cast<long long>(result.seconds * 1000) << " pv";
+	for (const Chess::Move& move : result.pv) {
+		line << " " << move.uci_name();
+	}
+	return line.str();
+}
+
+class UciEngine {
+
+public:
+	UciEngine() : hash_mb(16), threads(1), search(new Chess::Search(hash_mb)), searching(false), halted(false) {
+		game.load_fen(START_FEN);
+	}
+
+	~UciEngine() { stop_search(); }
+
+	// Handles one command line. Returns false once "quit" has been received.
+	bool handle(const std::string& line) {
+		std::istringstream tokens(line);
+		std::string command;
+		tokens >> command;
+
+		if (command == "uci") {
+			send("id name ChessGame");
+			send("id author chasefeng11");
+			send("option name Hash type spin default 16 min 1 max 4096");
+			send("option name Threads type spin default 1 min 1 max 256");
+			send("uciok");
+		} else if (command == "isready") {
+			send("readyok");
+		} else if (command == "ucinewgame") {
+			stop_search();
+			search->clear();
+		} else if (command == "setoption") {
+			stop_search();
+			set_option(tokens);
+		} else if (command == "position") {
+			stop_search();
+			set_position(tokens);
+		} else if (command == "go") {
+			stop_search();
+			go(tokens);
+		} else if (command == "stop") {
+			stop_search();
+		} else if (command == "quit") {
+			stop_search();
+			return false;
+		}
+		// Unknown commands are ignored, as the protocol asks
+		return true;
+	}
+
+private:
+	Chess::Game game;
+	std::size_t hash_mb;
+	int threads;
+	std::unique_ptr<Chess::Search> search;
+
+	// The running search, if any, whether it has returned yet, and whether it was told to stop
+	std::thread search_thread;
+	std::atomic<bool> searching;
+	std::atomic<bool> halted;
+
+	// "setoption name <name> value <value>"
+	void set_option(std::istringstream& tokens) {
+		std::string word;
+		std::string name;
+		std::string value;
+		tokens >> word >> name >> word >> value;
+
+		if (name == "Hash" && std::atoi(value.c_str()) > 0) {
+			hash_mb = static_cast<std::size_t>(std::atoi(value.c_str()));
+			search.reset(new Chess::Search(hash_mb));
+			search->set_threads(threads);
+		} else if (name == "Threads" && std::atoi(value.c_str()) > 0) {
+			threads = std::atoi(value.c_str());
+			search->set_threads(threads);
+		}
+	}
+
+	// "position startpos|fen <fen> [moves <move>...]"
+	void set_position(std::istringstream& tokens) {
+		std::string word;
+		tokens >> word;
+
+		std::string fen;
+		if (word == "startpos") {
+			fen = START_FEN;
+			tokens >> word;
+		} else if (word == "fen") {
+			while (tokens >> word && word != "moves") {
+				fen += (fen.empty() ? "" : " ") + word;
+			}
+		} else {
+			return;
+		}
+
+		try {
+			game.load_fen(fen);
+		} catch (const Chess::Exception& e) {
+			send(std::string("info string ") + e.what());
+			return;
+		}
+
+		if (word != "moves") {
+			return;
+		}
+		while (tokens >> word) {
+			Chess::Move move;
+			if (!game.find_uci_move(word, move)) {
+				send("info string illegal move " + word);
+				return;
+			}
+			game.do_move(move);
+		}
+	}
+
+	// "go [depth <n>] [movetime <ms>] [nodes <n>] [wtime <ms> btime <ms> ...] [infinite]"
+	void go(std::istringstream& tokens) {
+		Chess::SearchLimits limits;
+		bool infinite = false;
+		long long time_left = 0;
+		long long increment = 0;
+		int moves_to_go = 0;
+		std::string word;
+		while (tokens >> word) {
+			long long value = 0;
+			if (word != "infinite" && word != "ponder") {
+				tokens >> value;
+			}
+			if (word == "infinite") {
+				infinite = true;
+			} else if (word == "depth") {
+				limits.depth = static_cast<int>(value);
+			} else if (word == "movetime") {
+				limits.time_ms = static_cast<int>(value);
+			} else if (word == "nodes") {
+				limits.nodes = static_cast<unsigned long long>(value);
+			} else if (word == (game.turn_white() ? "wtime" : "btime")) {
+				time_left = value;
+			} else if (word == (game.turn_white() ? "winc" : "binc")) {
+				increment = value;
+			} else if (word == "movestogo") {
+				moves_to_go = static_cast<int>(value);
+			}
+		}
+
+		// With a clock, spend an even share of the remaining time plus most of the increment
+		if (limits.time_ms == 0 && time_left > 0) {
+			long long share = time_left / (moves_to_go > 0 ? moves_to_go + 1 : 30) + increment * 3 / 4;
+			limits.time_ms = static_cast<int>(std::max(1LL, std::min(share, time_left - 50)));
+		}
+
+		searching = true;
+		halted = false;
+		Chess::Search* engine = search.get();
+		Chess::Game position = game;
+		search_thread = std::thread([this, engine, position, limits, infinite] {
+			engine->set_info_callback([](const Chess::SearchResult& result) { send(info_line(result)); });
+			Chess::SearchResult result = engine->run(position, limits);
+
+			// An infinite search may end early, e.g. on finding a mate, but its
+			// best move must not be sent before "stop"
+			while (infinite && !halted) {
+				std::this_thread::sleep_for(std::chrono::milliseconds(1));
+			}
+			send("bestmove " + result.best_move.uci_name());
+			searching = false;
+		});
+	}
+
+	// Ends the running search, which then reports its best move, and waits for it
+	void stop_search() {
+		if (!search_thread.joinable()) {
+			return;
+		}
+		halted = true;
+
+		// A stop() that lands before the search has started is cleared when it
+		// starts, so keep asking until the search reports that it has returned
+		while (searching) {
+			search->stop();
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+		search_thread.join();
+	}
+};
+
+int main() {
+	UciEngine engine;
+	std::string line;
+	while (std::getline(std::cin, line)) {
+		if (!engine.handle(line)) {
+			break;
+		}
+	}
+	return 0;
+}